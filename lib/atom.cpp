@@ -13,6 +13,27 @@
 
 #include "atom.hpp"
 
+// Number of integrations performed by the current thread, used to report
+// the cost of converging each state
+static thread_local long shoot_count = 0;
+
+// Energy tolerance (Ha) and iterations on the coarse grid of convergeState:
+// its own discretisation error is much larger anyway
+static const double COARSE_ETOL = 1e-3;
+static const int COARSE_MAXIT_E = 10;
+// Finest grid used by refineState, with step dx/2^MAX_REFINE_LEVEL, and
+// largest step of the grids it compares: on coarser ones the energy search
+// can stop far from the solution, spoiling the error estimate
+static const int MAX_REFINE_LEVEL = 5;
+static const double MAX_DOUBLING_DX = 0.01;
+// Outer radius of the series used near the origin by series_boundaries, as a
+// fraction of the nuclear radius or, for a point nucleus, of the Bohr radius,
+// and number of points the potential inside the nucleus is fitted on. Further
+// out, the tabulated Fermi potential is not smooth enough to be fitted
+static const double SERIES_NUCLEAR_RADIUS = 0.25;
+static const double SERIES_BOHR_RADIUS = 0.5;
+static const int SERIES_FIT_POINTS = 16;
+
 /**
  * @brief  Initialise a TransitionMatrix class instance
  * @note   Initialise a TransitionMatrix class instance.
@@ -128,14 +149,15 @@ Atom::Atom(int Z, double m, int A, NuclearRadiusModel radius_model, double fc,
   }
 
   if (radius_model == FERMI2) {
-    V_coulomb = new CoulombFermi2Potential(Z, R, A);
+    V_coulomb = make_shared<CoulombFermi2Potential>(Z, R, A);
   } else {
-    V_coulomb = new CoulombSpherePotential(Z, R);
+    V_coulomb = make_shared<CoulombSpherePotential>(Z, R);
   }
 
   // Grid
   rc = fc * max(1 / (Z * mu), R);
   this->dx = dx;
+  Vtable_mutex = make_shared<mutex>();
 
   // Logging
   LOG(INFO) << "Created atom with Z = " << Z << ", A = " << A << "\n";
@@ -149,7 +171,8 @@ Atom::Atom(int Z, double m, int A, NuclearRadiusModel radius_model, double fc,
 /**
  * @brief Set parameters for the Fermi 2-term potential term (if used)
  * @note  Set the thickness parameter for the Fermi 2-term potential term (if used).
- * Calling this function resets all computed states.
+ * Calling this function resets all computed states, keeping them as warm
+ * starts (see DiracAtom::reset).
  *
  * @param  thickness:  The new thickness to set up
  * @retval None
@@ -161,35 +184,108 @@ void Atom::setFermi2(double thickness) {
     return;
   }
 
-  V_coulomb = new CoulombFermi2Potential(Z, R, A, thickness);
-  reset();
+  V_coulomb = make_shared<CoulombFermi2Potential>(Z, R, A, thickness);
+  fermi2_T = thickness;
+  clearVTable();
+  reset(true);
+}
+
+/**
+ * @brief  Set the nuclear radius
+ * @note   Set the radius of the nucleus, rebuilding the Coulomb potential
+ * of the nuclear model (keeping the Fermi 2-term thickness, if used) and the
+ * Uehling potential, if it is on, with the same settings. The central radius
+ * of the grid can be changed at the same time, since it usually follows the
+ * nuclear radius (see the constructor). Calling this function resets all
+ * computed states, keeping them as warm starts (see DiracAtom::reset).
+ *
+ * @param  R:   The new nuclear radius
+ * @param  rc:  The new central radius of the grid (default = -1, unchanged)
+ * @retval None
+ */
+void Atom::setRadius(double R, double rc) {
+  if (rmodel == POINT) {
+    LOG(WARNING) << "Trying to set up nuclear radius for an atom"
+                 << " using a point-like nucleus\n";
+    return;
+  }
+  if (R <= 0) {
+    throw invalid_argument("Nuclear radius must be positive");
+  }
+
+  this->R = R;
+  if (rmodel == FERMI2) {
+    V_coulomb = make_shared<CoulombFermi2Potential>(Z, R, A, fermi2_T);
+  } else {
+    V_coulomb = make_shared<CoulombSpherePotential>(Z, R);
+  }
+  if (use_uehling) {
+    V_uehling = UehlingSpherePotential(Z, R, uehling_steps);
+    V_uehling.set_exp_cutoffs(uehling_cut_low, uehling_cut_high);
+    if (uehling_tabulated) {
+      V_uehling.set_tabulated(true);
+    }
+  }
+  LOG(INFO) << "Atomic radius = " << R << " au\n";
+  if (rc > 0) {
+    this->rc = rc;
+    LOG(INFO) << "Logarithmic grid parameters rc = " << rc << " au, dx = " << dx
+              << "\n";
+  }
+
+  clearVTable();
+  reset(true);
 }
 
 /**
  * @brief  Set parameters for the Uehling potential term
  * @note   Set up the Uehling potential term, activating/deactivating
  * it and setting the number of steps used for its integration.
- * Calling this function resets all computed states.
+ * Calling this function resets all computed states, keeping them as warm
+ * starts (see DiracAtom::reset), or only their corrections with
+ * PERTURBATIVE_CORRECTIONS.
  *
  * @param  s:          Whether the Uehling potential should be on/off
  * @param  usteps:     Number of integration steps used for it (default = 1000)
+ * @param  cut_low:    Low cutoff for the exponential (default = 0)
+ * @param  cut_high:   High cutoff for the exponential (default = INFINITY)
+ * @param  tabulated:  If true, precompute the potential on a table and
+ * interpolate it, ignoring the cutoffs (default = false)
  * @retval None
  */
-void Atom::setUehling(bool s, int usteps, double cut_low, double cut_high) {
+void Atom::setUehling(bool s, int usteps, double cut_low, double cut_high,
+                      bool tabulated) {
   use_uehling = s;
   if (s) {
     LOG(INFO) << "Initialising Uehling potential with " << usteps
               << " integration steps\n";
     V_uehling = UehlingSpherePotential(Z, R, usteps);
     V_uehling.set_exp_cutoffs(cut_low, cut_high);
+    uehling_steps = usteps;
+    uehling_cut_low = cut_low;
+    uehling_cut_high = cut_high;
+    uehling_tabulated = tabulated;
+    if (tabulated) {
+      V_uehling.set_tabulated(true);
+      LOG(INFO) << "Uehling potential tabulated, maximum relative error = "
+                << V_uehling.get_table_error() << "\n";
+    }
   }
-  reset();
+  clearVTable();
+  if (correction_mode == PERTURBATIVE_CORRECTIONS) {
+    // The states do not depend on the corrections
+    resetCorrections();
+    return;
+  }
+  reset(true);
 }
 
 /**
  * @brief  Set electronic background configuration
  * @note   Set electronic background configuration to
- * include electronic shielding for muons.
+ * include electronic shielding for muons. Calling this function resets all
+ * computed states, keeping them as warm starts (see DiracAtom::reset), or
+ * only their corrections with PERTURBATIVE_CORRECTIONS.
  *
  * @param  s:           Whether the electronic background should be on/off
  * @param  econf:       Electronic configuration to use
@@ -222,7 +318,46 @@ void Atom::setElectBkgConfig(bool s, ElectronicConfiguration econf,
     LOG(INFO) << "Background potential initialised, total charge = "
               << V_econf.getQ() << "\n";
     LOG(TRACE) << "V_elec(0) = " << V_econf.V(0.0) << "\n";
+
+    // Describe the settings, in case they need to be compared later
+    ostringstream key;
+    key << setprecision(17) << "Z=" << econf.Z << ";mu=" << econf.mu
+        << ";shield=" << econf.shield << ";dirac=" << econf.dirac << ";pop=";
+    for (int n = 1; n <= econf.maxn(); ++n) {
+      for (int l = 0; l < n; ++l) {
+        key << econf.getPopulation(n, l) << ",";
+      }
+    }
+    key << ";rho_eps=" << rho_eps << ";max_r0=" << max_r0 << ";min_r1=" << min_r1;
+    econf_key = key.str();
+  } else {
+    econf_key = "";
+  }
+  clearVTable();
+  if (correction_mode == PERTURBATIVE_CORRECTIONS) {
+    // The states do not depend on the corrections
+    resetCorrections();
+    return;
   }
+  reset(true);
+}
+
+/**
+ * @brief  Set how the Uehling and electronic background terms are included
+ * @note   With FULL_CORRECTIONS, the Uehling and electronic background terms
+ * are part of the potential used to find the states. With
+ * PERTURBATIVE_CORRECTIONS, the states are found with the nuclear potential
+ * alone, and the terms are added to their energies to first order in
+ * perturbation theory; changing the terms afterwards then only requires
+ * computing the corrections again. Calling this function resets all computed
+ * states.
+ *
+ * @param  mode:       Correction mode
+ * @retval None
+ */
+void Atom::setCorrectionMode(CorrectionMode mode) {
+  correction_mode = mode;
+  clearVTable();
   reset();
 }
 
@@ -234,7 +369,7 @@ void Atom::setElectBkgConfig(bool s, ElectronicConfiguration econf,
  * r = rc*exp(i*dx)
  *
  * where i can be any integer number. Calling this function resets
- * all computed states.
+ * all computed states, keeping them as warm starts (see DiracAtom::reset).
  *
  * @param  rc:         Central radius of the grid
  * @param  dx:         Logarithmic step of the grid
@@ -244,7 +379,8 @@ void Atom::setgrid(double rc, double dx) {
   this->rc = rc;
   this->dx = dx;
 
-  reset();
+  clearVTable();
+  reset(true);
 }
 
 /**
@@ -259,6 +395,9 @@ double Atom::getV(double r) {
   double Vout;
 
   Vout = V_coulomb->V(r);
+  if (correction_mode == PERTURBATIVE_CORRECTIONS) {
+    return Vout;
+  }
   if (use_uehling) {
     Vout += V_uehling.V(r);
   }
@@ -269,6 +408,28 @@ double Atom::getV(double r) {
   return Vout;
 }
 
+/**
+ * @brief  Compute the corrections to the electrostatic potential
+ * @note   Compute the sum of the Uehling and electronic background terms of
+ * the potential at a specific point, whichever of them are switched on,
+ * regardless of the correction mode.
+ *
+ * @param r:        Point to compute the corrections on
+ * @retval          Computed corrections
+ */
+double Atom::getVCorrection(double r) {
+  double dV = 0;
+
+  if (use_uehling) {
+    dV += V_uehling.V(r);
+  }
+  if (use_econf) {
+    dV += V_econf.V(r);
+  }
+
+  return dV;
+}
+
 /**
  * @brief  Recalculate the electrostatic potential
  * @note   Recalculate the electrostatic potential for an atom. Done
@@ -288,6 +449,271 @@ vector<double> Atom::getV(vector<double> r) {
   return Vout;
 }
 
+/**
+ * @brief  Extend the tabulated grid and potential
+ * @note   Make sure that the tables of grid points, their logarithm and the
+ * potential cover the indices i0 <= i <= i1, computing only the values that
+ * are missing. Tables that need to grow are replaced by new ones, so that
+ * slices of the old ones held by states remain valid. Vtable_mutex must be
+ * locked by the caller.
+ *
+ * @param  i0:      Starting index
+ * @param  i1:      End index
+ * @retval None
+ */
+void Atom::extendTables(int i0, int i1) {
+  if (i1 < i0) {
+    throw invalid_argument("i1 must be greater or equal than i0 in getVgrid");
+  }
+
+  if (!Vtable || Vtable->size() == 0) {
+    Vtable_i0 = i0;
+    Vtable_i1 = i0 - 1;
+  }
+  if (i0 >= Vtable_i0 && i1 <= Vtable_i1) {
+    return;
+  }
+
+  int new_i0 = min(i0, Vtable_i0), new_i1 = max(i1, Vtable_i1);
+  int N = new_i1 - new_i0 + 1;
+  shared_ptr<vector<double>> r = make_shared<vector<double>>(N);
+  shared_ptr<vector<double>> logr = make_shared<vector<double>>(N);
+  shared_ptr<vector<double>> V = make_shared<vector<double>>(N);
+
+  for (int i = new_i0; i <= new_i1; ++i) {
+    int j = i - new_i0;
+    if (i >= Vtable_i0 && i <= Vtable_i1) {
+      (*r)[j] = (*rtable)[i - Vtable_i0];
+      (*logr)[j] = (*logrtable)[i - Vtable_i0];
+      (*V)[j] = (*Vtable)[i - Vtable_i0];
+    } else {
+      (*logr)[j] = i * dx;
+      (*r)[j] = rc * exp((*logr)[j]);
+      (*V)[j] = getV((*r)[j]);
+    }
+  }
+
+  rtable = r;
+  logrtable = logr;
+  Vtable = V;
+  Vtable_i0 = new_i0;
+  Vtable_i1 = new_i1;
+}
+
+/**
+ * @brief  Get the electrostatic potential on a range of grid points
+ * @note   Get the electrostatic potential on the grid points
+ *
+ * r = rc*exp(i*dx)
+ *
+ * for i0 <= i <= i1. Values are computed only once per index and stored,
+ * so that repeated requests (e.g. for each trial energy while converging
+ * a state) only need to copy them. The table is extended as needed and
+ * cleared whenever the grid or the potential change.
+ *
+ * @param  i0:      Starting index
+ * @param  i1:      End index
+ * @retval          Computed potential
+ */
+vector<double> Atom::getVgrid(int i0, int i1) {
+  lock_guard<mutex> lock(*Vtable_mutex);
+
+  extendTables(i0, i1);
+
+  return vector<double>(Vtable->begin() + (i0 - Vtable_i0),
+                        Vtable->begin() + (i1 - Vtable_i0 + 1));
+}
+
+/**
+ * @brief  Get the grid and potential on a range of grid points, without
+ * copying them
+ * @note   Get the grid points r = rc*exp(i*dx), their logarithm and the
+ * potential for i0 <= i <= i1 as slices of the tables kept by the atom (see
+ * getVgrid), which are shared with all the states that use them rather than
+ * copied.
+ *
+ * @param  i0:      Starting index
+ * @param  i1:      End index
+ * @param  &r:      Grid
+ * @param  &logr:   Logarithm of the grid
+ * @param  &V:      Potential
+ * @retval None
+ */
+void Atom::getGridSlices(int i0, int i1, SharedSlice &r, SharedSlice &logr,
+                         SharedSlice &V) {
+  lock_guard<mutex> lock(*Vtable_mutex);
+
+  extendTables(i0, i1);
+
+  r = SharedSlice(rtable, i0 - Vtable_i0, i1 - i0 + 1);
+  logr = SharedSlice(logrtable, i0 - Vtable_i0, i1 - i0 + 1);
+  V = SharedSlice(Vtable, i0 - Vtable_i0, i1 - i0 + 1);
+}
+
+/**
+ * @brief  Get the potential at the midpoints between grid points, without
+ * copying it
+ * @note   Get the potential at the points r = rc*exp((i+1/2)*dx) for
+ * i0 <= i <= i1, as used by the integrators that need it between grid points
+ * (see shootDiracLog). As for getGridSlices, the values are tabulated and
+ * shared; the table is only computed when first needed.
+ *
+ * @param  i0:      Starting index
+ * @param  i1:      End index
+ * @retval          Potential at the midpoints
+ */
+SharedSlice Atom::getVmidSlice(int i0, int i1) {
+  lock_guard<mutex> lock(*Vtable_mutex);
+
+  if (i1 < i0) {
+    return SharedSlice();
+  }
+  if (!Vmidtable || Vmidtable->size() == 0) {
+    Vmidtable_i0 = i0;
+    Vmidtable_i1 = i0 - 1;
+  }
+  if (i0 < Vmidtable_i0 || i1 > Vmidtable_i1) {
+    int new_i0 = min(i0, Vmidtable_i0), new_i1 = max(i1, Vmidtable_i1);
+    shared_ptr<vector<double>> V =
+      make_shared<vector<double>>(new_i1 - new_i0 + 1);
+
+    for (int i = new_i0; i <= new_i1; ++i) {
+      if (i >= Vmidtable_i0 && i <= Vmidtable_i1) {
+        (*V)[i - new_i0] = (*Vmidtable)[i - Vmidtable_i0];
+      } else {
+        (*V)[i - new_i0] = getV(rc * exp((i + 0.5) * dx));
+      }
+    }
+
+    Vmidtable = V;
+    Vmidtable_i0 = new_i0;
+    Vmidtable_i1 = new_i1;
+  }
+
+  return SharedSlice(Vmidtable, i0 - Vmidtable_i0, i1 - i0 + 1);
+}
+
+/**
+ * @brief  Get the corrections to the potential on a range of grid points,
+ * without copying them
+ * @note   Get the Uehling and electronic background terms of the potential
+ * (see getVCorrection) at the grid points r = rc*exp(i*dx) for i0 <= i <= i1,
+ * as used to correct the energies of states with PERTURBATIVE_CORRECTIONS. As
+ * for getVmidSlice, the values are tabulated and shared; the table is only
+ * computed when first needed.
+ *
+ * @param  i0:      Starting index
+ * @param  i1:      End index
+ * @retval          Corrections to the potential
+ */
+SharedSlice Atom::getVCorrectionSlice(int i0, int i1) {
+  lock_guard<mutex> lock(*Vtable_mutex);
+
+  if (i1 < i0) {
+    return SharedSlice();
+  }
+  if (!dVtable || dVtable->size() == 0) {
+    dVtable_i0 = i0;
+    dVtable_i1 = i0 - 1;
+  }
+  if (i0 < dVtable_i0 || i1 > dVtable_i1) {
+    int new_i0 = min(i0, dVtable_i0), new_i1 = max(i1, dVtable_i1);
+    shared_ptr<vector<double>> dV =
+      make_shared<vector<double>>(new_i1 - new_i0 + 1);
+
+    for (int i = new_i0; i <= new_i1; ++i) {
+      if (i >= dVtable_i0 && i <= dVtable_i1) {
+        (*dV)[i - new_i0] = (*dVtable)[i - dVtable_i0];
+      } else {
+        (*dV)[i - new_i0] = getVCorrection(rc * exp(i * dx));
+      }
+    }
+
+    dVtable = dV;
+    dVtable_i0 = new_i0;
+    dVtable_i1 = new_i1;
+  }
+
+  return SharedSlice(dVtable, i0 - dVtable_i0, i1 - i0 + 1);
+}
+
+/**
+ * @brief  Get the expansion of the potential inside the nucleus
+ * @note   Get the coefficients c0, c2, c4 of V(r) ~ c0 + c2 r^2 + c4 r^4 for
+ * 0 < r <= r1, as used by boundaryDiracSeries for a finite nucleus. They are
+ * a least squares fit of the potential on SERIES_FIT_POINTS points, exact
+ * for a uniformly charged sphere, and are only computed once for each r1.
+ *
+ * @param  r1:      Outer radius of the expansion
+ * @retval          Coefficients of r^0, r^2, r^4
+ */
+vector<double> Atom::getVSeries(double r1) {
+  lock_guard<mutex> lock(*Vtable_mutex);
+
+  if (Vseries.size() > 0 && Vseries_r1 == r1) {
+    return Vseries;
+  }
+
+  // Normal equations for a polynomial in u = (r/r1)^2
+  double A[3][4] = {};
+  for (int j = 1; j <= SERIES_FIT_POINTS; ++j) {
+    double r = r1 * j / SERIES_FIT_POINTS;
+    double u = pow(r / r1, 2), v = getV(r);
+    double up[3] = {1, u, u * u};
+    for (int a = 0; a < 3; ++a) {
+      for (int b = 0; b < 3; ++b) {
+        A[a][b] += up[a] * up[b];
+      }
+      A[a][3] += up[a] * v;
+    }
+  }
+  for (int a = 0; a < 3; ++a) {
+    for (int b = a + 1; b < 3; ++b) {
+      double f = A[b][a] / A[a][a];
+      for (int c = a; c < 4; ++c) {
+        A[b][c] -= f * A[a][c];
+      }
+    }
+  }
+  vector<double> c(3);
+  for (int a = 2; a >= 0; --a) {
+    c[a] = A[a][3];
+    for (int b = a + 1; b < 3; ++b) {
+      c[a] -= A[a][b] * c[b];
+    }
+    c[a] /= A[a][a];
+  }
+
+  Vseries = {c[0], c[1] / pow(r1, 2), c[2] / pow(r1, 4)};
+  Vseries_r1 = r1;
+
+  return Vseries;
+}
+
+/**
+ * @brief  Clear the tabulated potential
+ * @note   Clear the tables used by getVgrid. Must be called whenever
+ * anything that affects the potential or the grid changes. States computed
+ * before keep the old tables.
+ *
+ * @retval None
+ */
+void Atom::clearVTable() {
+  lock_guard<mutex> lock(*Vtable_mutex);
+  rtable.reset();
+  logrtable.reset();
+  Vtable.reset();
+  Vtable_i0 = 0;
+  Vtable_i1 = -1;
+  Vmidtable.reset();
+  Vmidtable_i0 = 0;
+  Vmidtable_i1 = -1;
+  Vseries.clear();
+  dVtable.reset();
+  dVtable_i0 = 0;
+  dVtable_i1 = -1;
+}
+
 // Nuclear radius models
 
 /**
@@ -330,14 +756,299 @@ DiracAtom::DiracAtom(int Z, double m, int A, NuclearRadiusModel radius_model,
   : Atom(Z, m, A, radius_model, fc, dx) {
   restE = mu * pow(Physical::c, 2);
   LOG(DEBUG) << "Rest energy = " << restE / Physical::eV << " eV\n";
+  states_mutex = make_shared<mutex>();
   idshell = ideal_minshell;
   if (idshell > 0)
     LOG(INFO) << "Using hydrogen-like solution for n >= " << idshell
               << "\n";
 }
 
-void DiracAtom::reset() {
+/**
+ * @brief  Clear the computed states
+ * @note   Clear all the computed states, and the grid copies and corrections
+ * that depend on them. If warm is true, the converged states are kept as
+ * warm starts for convergeState, so that after a small change in the
+ * potential or grid each state only needs a few iterations starting from its
+ * previous energy; otherwise, any warm starts are discarded too.
+ *
+ * @param  warm:    Whether to keep the converged states as warm starts
+ * @retval None
+ */
+void DiracAtom::reset(bool warm) {
+  lock_guard<mutex> lock(*states_mutex);
+  if (warm) {
+    for (auto it = states.begin(); it != states.end(); ++it) {
+      if (it->second.converged) {
+        warm_states[it->first] = it->second;
+      }
+    }
+  } else {
+    warm_states.clear();
+  }
   states.clear();
+  grid_atoms.clear();
+  coarse_atom = nullptr;
+  cache_loaded = false;
+  corrections.clear();
+}
+
+void DiracAtom::resetCorrections() {
+  lock_guard<mutex> lock(*states_mutex);
+  corrections.clear();
+}
+
+/**
+ * @brief  Set the accuracy required on the transition energies
+ * @note   Set the accuracy required on the energy of every transition. The
+ * energy of each state found by shooting is then refined with refineState
+ * on grids only as fine as needed for it, and the energy tolerance Etol is
+ * set to a small fraction of the target, so that it does not limit the
+ * accuracy, nor waste iterations well below it. A value of 0 turns this off
+ * and leaves Etol unchanged.
+ *
+ * @param  acc:     Accuracy on transition energies (Ha)
+ * @retval None
+ */
+void DiracAtom::setTargetAccuracy(double acc) {
+  target_accuracy = acc;
+  if (acc > 0) {
+    Etol = acc / 20;
+  }
+  reset();
+}
+
+/**
+ * @brief  Use the states of another atom as warm starts
+ * @note   Add the states converged so far by another atom, for example a
+ * different isotope of the same element, to the warm starts used by
+ * convergeState (see reset), so that each state only needs a few iterations
+ * starting from the energy it has there.
+ *
+ * @param  &other:  Atom whose states to use
+ * @retval None
+ */
+void DiracAtom::warmStart(DiracAtom &other) {
+  map<tuple<int, int, bool>, DiracState> other_states;
+  {
+    lock_guard<mutex> lock(*other.states_mutex);
+    other_states = other.states;
+  }
+
+  lock_guard<mutex> lock(*states_mutex);
+  for (auto it = other_states.begin(); it != other_states.end(); ++it) {
+    if (it->second.converged) {
+      warm_states[it->first] = it->second;
+    }
+  }
+}
+
+/**
+ * @brief  Set a directory to use as persistent cache of converged states
+ * @note   Set a directory in which converged states are stored between runs.
+ * Each combination of parameters affecting the solution (see stateCacheKey)
+ * gets its own file, so states are only ever reused for identical settings.
+ * Cached states are loaded the first time a state is requested, and new ones
+ * are only written when saveStateCache is called. An empty string disables
+ * the cache.
+ *
+ * @param  dir:     Path of the directory (must already exist)
+ * @retval None
+ */
+void DiracAtom::setStateCache(string dir) {
+  lock_guard<mutex> lock(*states_mutex);
+  cache_dir = dir;
+  cache_loaded = false;
+}
+
+/**
+ * @brief  Key identifying the settings of this atom for the state cache
+ * @note   Return a string describing all the parameters that affect the
+ * converged states: nuclear properties and model, additional potential terms,
+ * grid and convergence tolerances.
+ *
+ * @retval Key string
+ */
+string DiracAtom::stateCacheKey() {
+  ostringstream key;
+
+  key << setprecision(17);
+  key << "mudirac-states-4;Z=" << Z << ";A=" << A << ";m=" << m << ";mu=" << mu
+      << ";R=" << R << ";rmodel=" << rmodel;
+  if (rmodel == FERMI2) {
+    key << ";fermi2_T=" << fermi2_T;
+  }
+  if (correction_mode == PERTURBATIVE_CORRECTIONS) {
+    // The states do not depend on the corrections
+    key << ";corrections=perturbative";
+  } else {
+    key << ";uehling=" << use_uehling;
+    if (use_uehling) {
+      key << ";usteps=" << uehling_steps << ";ucut_low=" << uehling_cut_low
+          << ";ucut_high=" << uehling_cut_high
+          << ";utab=" << uehling_tabulated;
+    }
+    key << ";econf=" << (use_econf ? econf_key : "none");
+  }
+  key << ";rc=" << rc << ";dx=" << dx << ";Etol=" << Etol
+      << ";in_eps=" << in_eps << ";out_eps=" << out_eps
+      << ";nodetol=" << nodetol << ";idshell=" << idshell;
+  if (solver == BSPLINE) {
+    key << ";solver=bspline;bsize=" << bspline_size
+        << ";border=" << bspline_order;
+  } else {
+    if (series_boundaries) {
+      key << ";series=1";
+    }
+    if (shoot_method != RK4_AVERAGED) {
+      key << ";method=" << shoot_method;
+      if (shoot_method == DORMAND_PRINCE) {
+        key << ";shoot_tol=" << shoot_tol;
+      }
+    }
+    if (target_accuracy > 0) {
+      key << ";accuracy=" << target_accuracy;
+    } else if (richardson_levels > 1) {
+      key << ";richardson=" << richardson_levels;
+    }
+  }
+
+  return key.str();
+}
+
+/**
+ * @brief  Path of the state cache file for the current settings
+ *
+ * @retval Path of the file, or an empty string if no cache is in use
+ */
+string DiracAtom::stateCacheFile() {
+  if (cache_dir == "") {
+    return "";
+  }
+
+  ostringstream fname;
+  fname << cache_dir << "/mudirac_" << hex << hashString(stateCacheKey())
+        << ".cache";
+
+  return fname.str();
+}
+
+/**
+ * @brief  Load converged states from the cache file
+ * @note   Load all converged states stored in the cache file for the current
+ * settings, without replacing any that have been computed already. Must be
+ * called with states_mutex locked.
+ *
+ * @retval None
+ */
+void DiracAtom::loadStateCache() {
+  cache_loaded = true;
+
+  string fname = stateCacheFile();
+  if (fname == "") {
+    return;
+  }
+
+  ifstream in(fname, ios::binary);
+  if (!in) {
+    LOG(DEBUG) << "No state cache file found at " << fname << "\n";
+    return;
+  }
+
+  try {
+    string key = stateCacheKey();
+    int keylen, nstates;
+
+    in.read(reinterpret_cast<char *>(&keylen), sizeof(int));
+    if (!in || keylen != (int)key.size()) {
+      throw runtime_error("key mismatch");
+    }
+    string filekey(keylen, ' ');
+    in.read(&filekey[0], keylen);
+    if (filekey != key) {
+      throw runtime_error("key mismatch");
+    }
+
+    in.read(reinterpret_cast<char *>(&nstates), sizeof(int));
+    for (int i = 0; i < nstates; ++i) {
+      int n, l;
+      char s;
+      DiracState st;
+      in.read(reinterpret_cast<char *>(&n), sizeof(int));
+      in.read(reinterpret_cast<char *>(&l), sizeof(int));
+      in.read(&s, 1);
+      st.load(in);
+      tuple<int, int, bool> qn = make_tuple(n, l, bool(s));
+      if (!states[qn].converged) {
+        states[qn] = st;
+      }
+    }
+    LOG(INFO) << "Loaded " << nstates << " states from cache file " << fname
+              << "\n";
+  } catch (const runtime_error &e) {
+    LOG(WARNING) << "Could not read state cache file " << fname << ": "
+                 << e.what() << "\n";
+  }
+}
+
+/**
+ * @brief  Save all converged states to the cache file
+ * @note   Write all the converged states to the cache file for the current
+ * settings, if a cache directory has been set. The file is written to a
+ * temporary path first and then moved in place.
+ *
+ * @retval None
+ */
+void DiracAtom::saveStateCache() {
+  lock_guard<mutex> lock(*states_mutex);
+
+  string fname = stateCacheFile();
+  if (fname == "") {
+    return;
+  }
+
+  // Make sure we don't lose states that were only in the file
+  if (!cache_loaded) {
+    loadStateCache();
+  }
+
+  string key = stateCacheKey();
+  string tmpname = fname + ".tmp";
+  ofstream out(tmpname, ios::binary);
+
+  if (!out) {
+    LOG(WARNING) << "Could not write state cache file " << fname << "\n";
+    return;
+  }
+
+  int keylen = key.size(), nstates = 0;
+  map<tuple<int, int, bool>, DiracState>::iterator it;
+
+  for (it = states.begin(); it != states.end(); ++it) {
+    nstates += it->second.converged;
+  }
+
+  out.write(reinterpret_cast<const char *>(&keylen), sizeof(int));
+  out.write(key.data(), keylen);
+  out.write(reinterpret_cast<const char *>(&nstates), sizeof(int));
+  for (it = states.begin(); it != states.end(); ++it) {
+    if (!it->second.converged) {
+      continue;
+    }
+    int n = get<0>(it->first), l = get<1>(it->first);
+    char s = get<2>(it->first);
+    out.write(reinterpret_cast<const char *>(&n), sizeof(int));
+    out.write(reinterpret_cast<const char *>(&l), sizeof(int));
+    out.write(&s, 1);
+    it->second.save(out);
+  }
+  out.close();
+
+  if (rename(tmpname.c_str(), fname.c_str()) != 0) {
+    LOG(WARNING) << "Could not write state cache file " << fname << "\n";
+    return;
+  }
+
+  LOG(INFO) << "Saved " << nstates << " states to cache file " << fname << "\n";
 }
 
 /**
@@ -366,6 +1077,7 @@ pair<double, double> DiracAtom::energyLimits(int nodes, int k) {
   // Required for the state to be bound
   maxE = restE;
 
+  lock_guard<mutex> lock(*states_mutex);
   for (it = states.begin(); it != states.end(); it++) {
     int itn, itl;
     bool its;
@@ -394,7 +1106,9 @@ pair<double, double> DiracAtom::energyLimits(int nodes, int k) {
  * number of nodes
  * @note   Perform a preliminary, rough bisection search to find an energy that
  * produces a wavefunction with the desired number of nodes for the given state.
- * This is then used as a starting point for full convergence.
+ * This is then used as a starting point for full convergence. If
+ * pruefer_nodes is set, convergeNodesPhase is used instead, and if
+ * shoot_lanes is greater than one, convergeNodesLanes.
  *
  * @param  &state:     DiracState to integrate
  * @param  &tp:        TurningPoint object to store turning point info
@@ -410,6 +1124,14 @@ void DiracAtom::convergeNodes(DiracState &state, TurningPoint &tp,
   double El, Er, oldEl = maxE + 1, oldEr = maxE + 1;
   pair<int, int> glim;
 
+  if (pruefer_nodes) {
+    convergeNodesPhase(state, tp, targ_nodes, minE, maxE);
+    return;
+  } else if (shoot_lanes > 1) {
+    convergeNodesLanes(state, tp, targ_nodes, minE, maxE);
+    return;
+  }
+
   k = state.k;
   El = minE + (maxE - minE) / 3.0;
   Er = maxE - (maxE - minE) / 3.0;
@@ -483,15 +1205,277 @@ void DiracAtom::convergeNodes(DiracState &state, TurningPoint &tp,
     "convergeNodes failed to find a suitable state - maximum iterations hit");
 }
 
-void DiracAtom::convergeE(DiracState &state, TurningPoint &tp, double &minE,
-                          double &maxE) {
-  int k;
-  double E, dE;
-  double Edamp_eff = abs(Edamp);
-  pair<int, int> glim;
-
-  k = state.k;
-  E = state.E;
+/**
+ * @brief  Converge a state to fall within an attraction basin with the required
+ * number of nodes, trying several energies per iteration
+ * @note   Same as convergeNodes, but at each iteration the energy interval is
+ * split in shoot_lanes+1 parts, and all the internal points are integrated
+ * with integrateStates. Each iteration costs shoot_lanes integrations, so
+ * this only pays off if they are cheaper together than one at a time.
+ *
+ * @param  &state:     DiracState to integrate
+ * @param  &tp:        TurningPoint object to store turning point info
+ * @param  targ_nodes: Target number of nodes
+ * @param  &minE:      Minimum energy (boundary will be updated through search)
+ * @param  &maxE:      Maximum energy (boundary will be updated through search)
+ * @retval None
+ */
+void DiracAtom::convergeNodesLanes(DiracState &state, TurningPoint &tp,
+                                   int targ_nodes, double &minE,
+                                   double &maxE) {
+  int k, L;
+  vector<double> E;
+  vector<int> nodes;
+  vector<DiracState> trials;
+  vector<TurningPoint> tps;
+  DiracWorkspace ws;
+
+  k = state.k;
+  L = max(shoot_lanes, 1);
+  E = vector<double>(L);
+  nodes = vector<int>(L);
+  trials = vector<DiracState>(L);
+
+  LOG(DEBUG) << "Running convergeNodesLanes to search energy with solution with "
+             << targ_nodes << " nodes\n";
+
+  for (int it = 0; it < maxit_nodes; ++it) {
+    LOG(DEBUG) << "Iteration " << (it + 1) << ", minE = " << minE - restE
+               << "+mc2, maxE = " << maxE - restE << "+mc2\n";
+
+    // Split the interval in L+1 equal parts and integrate all at once
+    for (int j = 0; j < L; ++j) {
+      E[j] = minE + (j + 1) * (maxE - minE) / (L + 1.0);
+      trials[j] = initState(E[j], k);
+    }
+    integrateStates(trials, tps, &ws);
+
+    int jlow = -1, jhigh = L;
+    for (int j = 0; j < L; ++j) {
+      trials[j].continuify(tps[j]);
+      trials[j].normalize();
+      trials[j].findNodes(nodetol);
+      nodes[j] = trials[j].nodes;
+      if (nodes[j] == targ_nodes) {
+        LOG(TRACE) << "State with " << targ_nodes
+                   << " nodes found at E = " << E[j] - restE << "+mc2\n";
+        state = trials[j];
+        tp = tps[j];
+        return;
+      } else if (nodes[j] < targ_nodes) {
+        jlow = j;
+      } else if (jhigh == L) {
+        jhigh = j;
+      }
+    }
+
+    LOG(TRACE) << "Nodes count: lowest = " << nodes[0]
+               << ", highest = " << nodes[L - 1] << "\n";
+
+    if (jlow > jhigh) {
+      // Doesn't make sense
+      throw runtime_error(
+        "convergeNodesLanes failed - higher number of nodes for lower energy");
+    }
+
+    // Restrict the search to the interval in between
+    if (jhigh < L) {
+      maxE = E[jhigh];
+    }
+    if (jlow >= 0) {
+      minE = E[jlow];
+    }
+  }
+
+  throw runtime_error(
+    "convergeNodesLanes failed to find a suitable state - maximum iterations hit");
+}
+
+/**
+ * @brief  Compute the Pruefer phase count for a given E and k
+ * @note   Integrate the Pruefer phase for a state of energy E and quantum
+ * number k on its grid (see shootDiracPhaseLog). The result is a continuous
+ * and increasing function of E, equal to n-|k| at the eigenvalue with
+ * principal quantum number n. This is the number of nodes of P, plus one for
+ * k > 0.
+ *
+ * @param  E:   Energy
+ * @param  k:   Quantum number k
+ * @retval      Phase difference at the turning point, in units of pi
+ */
+double DiracAtom::phaseCount(double E, int k) {
+  DiracState state = initState(E, k);
+  int N;
+
+  boundaryDiracCoulomb(state, mu, Z, R > state.grid[0] ? R : -1);
+  N = state.grid.size();
+  shoot_count++;
+
+  return shootDiracPhaseLog(state.Q[0], state.P[0], state.Q[N - 1],
+                            state.P[N - 1], state.grid, state.V, E, k, mu,
+                            dx);
+}
+
+/**
+ * @brief  Converge a state to fall within an attraction basin with the required
+ * number of nodes, using the Pruefer phase
+ * @note   Same as convergeNodes, but each trial energy only requires the
+ * integration of the Pruefer phase. Since this is a continuous function of
+ * the energy, equal to n-|k| at each eigenvalue (see phaseCount), the search
+ * uses the Illinois variant of regula falsi on it once both sides are known,
+ * and stops as soon as the phase is within 1/2 of the target. The full
+ * wavefunction is only integrated for the final energy, and nodetol plays no
+ * role in the search. If a table of phases already sampled for the same k is
+ * passed, it is used to narrow down the search, and extended with the new
+ * samples (see calcKappaSeries).
+ *
+ * @param  &state:     DiracState to integrate
+ * @param  &tp:        TurningPoint object to store turning point info
+ * @param  targ_nodes: Target number of nodes
+ * @param  &minE:      Minimum energy (boundary will be updated through search)
+ * @param  &maxE:      Maximum energy (boundary will be updated through search)
+ * @param  *phases:    Phases sampled so far for this k, by energy (default
+ * NULL)
+ * @retval None
+ */
+void DiracAtom::convergeNodesPhase(DiracState &state, TurningPoint &tp,
+                                   int targ_nodes, double &minE,
+                                   double &maxE, map<double, double> *phases) {
+  int k, side = 0, targ_phase;
+  double E, phase;
+  double flo = NAN, fhi = NAN;
+  double Ebasin = NAN;
+
+  k = state.k;
+  targ_phase = targ_nodes + (k > 0 ? 1 : 0);
+
+  LOG(DEBUG) << "Running convergeNodesPhase to search energy with solution "
+             << "with " << targ_nodes << " nodes\n";
+
+  if (phases != NULL) {
+    // Start from the closest known samples
+    map<double, double>::iterator it;
+    for (it = phases->begin(); it != phases->end(); ++it) {
+      if (it->first <= minE || it->first >= maxE) {
+        continue;
+      }
+      double f = it->second - targ_phase;
+      if (abs(f) < 0.5 && (std::isnan(Ebasin) || abs(f) < abs((*phases)[Ebasin] - targ_phase))) {
+        Ebasin = it->first;
+      }
+      if (f < 0) {
+        minE = it->first;
+        flo = f;
+      } else if (std::isnan(fhi)) {
+        maxE = it->first;
+        fhi = f;
+      }
+    }
+  }
+
+  for (int it = 0; it < maxit_nodes; ++it) {
+    E = (minE + maxE) / 2.0;
+    if (!std::isnan(flo) && !std::isnan(fhi)) {
+      double Ers = (minE * fhi - maxE * flo) / (fhi - flo);
+      if (Ers > minE && Ers < maxE) {
+        E = Ers;
+      }
+    }
+    if (!std::isnan(Ebasin)) {
+      E = Ebasin;
+      phase = (*phases)[E];
+      Ebasin = NAN;
+    } else {
+      phase = phaseCount(E, k);
+      if (phases != NULL) {
+        (*phases)[E] = phase;
+      }
+    }
+
+    LOG(DEBUG) << "Iteration " << (it + 1) << ", E = " << E - restE
+               << "+mc2, phase = " << phase << "\n";
+
+    if (abs(phase - targ_phase) < 0.5) {
+      LOG(TRACE) << "State with " << targ_nodes
+                 << " nodes found at E = " << E - restE << "+mc2\n";
+      state = initState(E, k);
+      integrateState(state, tp);
+      state.continuify(tp);
+      state.normalize();
+      state.findNodes(nodetol);
+      return;
+    }
+
+    if (phase < targ_phase) {
+      minE = E;
+      flo = phase - targ_phase;
+      if (side == -1) {
+        fhi /= 2; // Illinois modification
+      }
+      side = -1;
+    } else {
+      maxE = E;
+      fhi = phase - targ_phase;
+      if (side == 1) {
+        flo /= 2;
+      }
+      side = 1;
+    }
+  }
+
+  throw runtime_error(
+    "convergeNodes failed to find a suitable state - maximum iterations hit");
+}
+
+/**
+ * @brief  Converge the energy of a state with the right number of nodes
+ * @note   Converge the energy of a state, starting from one that has
+ * the required number of nodes, with the method set in Esearch.
+ *
+ * @param  &state:      DiracState to converge
+ * @param  &tp:         TurningPoint object to store turning point info
+ * @param  &minE:       Minimum energy
+ * @param  &maxE:       Maximum energy
+ * @param  integrated:  If true, state and tp already contain an integration
+ * at state.E, which can be reused (default = false)
+ * @retval None
+ */
+void DiracAtom::convergeE(DiracState &state, TurningPoint &tp, double &minE,
+                          double &maxE, bool integrated) {
+  switch (Esearch) {
+    case DAMPED_NEWTON:
+      convergeEDamped(state, tp, minE, maxE);
+      break;
+    case SAFE_NEWTON:
+      convergeESafe(state, tp, minE, maxE, integrated);
+      break;
+    default:
+      throw invalid_argument("Invalid energy search method");
+  }
+}
+
+/**
+ * @brief  Converge energy with damped Newton steps
+ * @note   Converge energy with Newton steps, each scaled by Edamp and limited
+ * to max_dE_ratio times the energy. When a step leaves the limits, the
+ * damping is halved.
+ *
+ * @param  &state:      DiracState to converge
+ * @param  &tp:         TurningPoint object to store turning point info
+ * @param  &minE:       Minimum energy
+ * @param  &maxE:       Maximum energy
+ * @retval None
+ */
+void DiracAtom::convergeEDamped(DiracState &state, TurningPoint &tp,
+                                double &minE, double &maxE) {
+  int k;
+  double E, dE;
+  double Edamp_eff = abs(Edamp);
+  pair<int, int> glim;
+  DiracWorkspace ws;
+
+  k = state.k;
+  E = state.E;
 
   LOG(DEBUG) << "Running convergeE to search energy from starting value of "
              << E - restE << " + mc2\n";
@@ -503,7 +1487,7 @@ void DiracAtom::convergeE(DiracState &state, TurningPoint &tp, double &minE,
                << " + mc2\n";
 
     state = initState(E, k);
-    integrateState(state, tp, dE);
+    integrateState(state, tp, dE, &ws);
 
     LOG(TRACE) << "Integration complete, computed error dE = " << dE << "\n";
 
@@ -544,6 +1528,118 @@ void DiracAtom::convergeE(DiracState &state, TurningPoint &tp, double &minE,
   throw runtime_error("Convergence failed in given number of iterations");
 }
 
+/**
+ * @brief  Converge energy with safeguarded Newton steps
+ * @note   Converge energy keeping a bracket [lo, hi] around the solution.
+ * The starting state is assumed to have the right number of nodes; any
+ * later state with a different number of nodes lies outside the attraction
+ * basin, and gives a limit for the bracket. Within the basin the Newton step
+ * g(E) = dE is approximately E-E0, so its sign tells on which side of the
+ * solution E lies, and it is used to shrink the bracket. Full Newton steps
+ * are taken as long as they fall inside the bracket; otherwise, once both
+ * sides are known within the basin, a step of the Illinois variant of regula
+ * falsi on g, and if not, bisection.
+ *
+ * @param  &state:      DiracState to converge
+ * @param  &tp:         TurningPoint object to store turning point info
+ * @param  &minE:       Minimum energy
+ * @param  &maxE:       Maximum energy
+ * @param  integrated:  If true, state and tp already contain an integration
+ * at state.E, which is used as the first iteration (default = false)
+ * @retval None
+ */
+void DiracAtom::convergeESafe(DiracState &state, TurningPoint &tp,
+                              double &minE, double &maxE, bool integrated) {
+  int k, side = 0, targ_nodes = -1;
+  double E, dE;
+  double lo = minE, hi = maxE, glo = NAN, ghi = NAN;
+  DiracWorkspace ws;
+
+  k = state.k;
+  E = state.E;
+
+  LOG(DEBUG) << "Running convergeE to search energy from starting value of "
+             << E - restE << " + mc2\n";
+  LOG(DEBUG) << "Energy limits: " << minE - restE << " + mc2 < E < "
+             << maxE - restE << " + mc2\n";
+
+  for (int it = 0; it < maxit_E; ++it) {
+    LOG(TRACE) << "Iteration " << (it + 1) << ", E = " << E - restE
+               << " + mc2\n";
+
+    if (it > 0 || !integrated) {
+      state = initState(E, k);
+      integrateState(state, tp, true);
+      state.continuify(tp);
+      state.findNodes(nodetol);
+    }
+    if (it == 0) {
+      targ_nodes = state.nodes;
+    }
+    dE = energyStep(state, tp, &ws);
+
+    LOG(TRACE) << "Integration complete, computed error dE = " << dE << "\n";
+
+    if (std::isnan(dE)) {
+      throw runtime_error("Invalid dE value returned by integrateState");
+    }
+
+    if (abs(dE) < Etol && state.nodes == targ_nodes) {
+      LOG(TRACE) << "Convergence complete after " << (it + 1)
+                 << " iterations\n";
+      state.normalize();
+      return;
+    }
+
+    // Update the bracket
+    if (state.nodes != targ_nodes) {
+      // Out of the basin; the sign of dE is meaningless here
+      LOG(TRACE) << "State has " << state.nodes << " nodes instead of "
+                 << targ_nodes << "\n";
+      if (state.nodes > targ_nodes) {
+        hi = E;
+        ghi = NAN;
+      } else {
+        lo = E;
+        glo = NAN;
+      }
+      side = 0;
+      dE = E - (lo + hi) / 2.0; // Force bisection
+    } else if (dE > 0) {
+      hi = E;
+      ghi = dE;
+      if (side == 1) {
+        glo /= 2; // Illinois modification
+      }
+      side = 1;
+    } else {
+      lo = E;
+      glo = dE;
+      if (side == -1) {
+        ghi /= 2;
+      }
+      side = -1;
+    }
+
+    double Enew = E - dE;
+    if (!(Enew > lo && Enew < hi)) {
+      if (!std::isnan(glo) && !std::isnan(ghi)) {
+        Enew = (lo * ghi - hi * glo) / (ghi - glo);
+        LOG(TRACE) << "Newton step out of bracket, regula falsi step to "
+                   << Enew - restE << " + mc2\n";
+      }
+      if (!(Enew > lo && Enew < hi)) {
+        Enew = (lo + hi) / 2.0;
+        LOG(TRACE) << "Newton step out of bracket, bisection step to "
+                   << Enew - restE << " + mc2\n";
+      }
+    }
+    E = Enew;
+  }
+
+  throw runtime_error("Convergence failed in given number of iterations");
+}
+
 /**
  * @brief  Compute grid limits for given E and k
  * @note   Compute ideal indices to use as grid limits for
@@ -634,11 +1730,14 @@ DiracState DiracAtom::initState(double E, int k) {
              << "\n";
 
   glimits = gridLimits(E, k);
-  state = DiracState(rc, dx, glimits.first, glimits.second);
+  state.grid_indices = glimits;
+  getGridSlices(glimits.first, glimits.second, state.grid, state.loggrid,
+                state.V);
+  state.Q = vector<double>(state.grid.size(), 0);
+  state.P = vector<double>(state.grid.size(), 0);
   state.m = mu;
   state.k = k;
   state.E = E;
-  state.V = getV(state.grid);
 
   return state;
 }
@@ -647,14 +1746,20 @@ DiracState DiracAtom::initState(double E, int k) {
  * @brief  Integrate a DiracState of given E, k and V
  * @note   Perform a single integration of a DiracState,
  * given its E, k and V (which must be set in the DiracState
- * object itself).
+ * object itself). With series_boundaries, the first points (up to a
+ * quarter of the nuclear radius, or half the Bohr radius for a point
+ * nucleus, and well before the turning point) are set by
+ * boundaryDiracSeries and the last one by boundaryDiracAsymptotic, so that
+ * only the rest is integrated.
  *
  * @param  &state:  DiracState to integrate
  * @param  &tp:     TurningPoint object to store turning point info
+ * @param  zeta:    If true, also integrate d/dE (Q/P) in the same passes,
+ * so that energyStep does not need to (default = false)
  * @retval
  */
-void DiracAtom::integrateState(DiracState &state, TurningPoint &tp) {
-  int N;
+void DiracAtom::integrateState(DiracState &state, TurningPoint &tp, bool zeta) {
+  int N, i_s = 0;
 
   N = state.grid.size();
   if (N == 0) {
@@ -662,9 +1767,65 @@ void DiracAtom::integrateState(DiracState &state, TurningPoint &tp) {
   }
   LOG(TRACE) << "Integrating state with grid of size " << N << "\n";
   // Start by applying boundary conditions
-  boundaryDiracCoulomb(state, mu, Z, R > state.grid[0] ? R : -1);
-  tp = shootDiracLog(state.Q, state.P, state.grid, state.V, state.E, state.k,
-                     mu, dx);
+  bool finite = R > state.grid[0];
+  if (series_boundaries) {
+    double r_s = 0;
+    vector<double> Vc;
+    if (finite) {
+      r_s = SERIES_NUCLEAR_RADIUS * R;
+      Vc = getVSeries(r_s);
+    } else {
+      // The Uehling potential is not Coulomb-like at any radius
+      if (!use_uehling) {
+        r_s = SERIES_BOHR_RADIUS / (Z * mu);
+      }
+      Vc = {state.V[0] + Z / state.grid[0]};
+    }
+    // Stay within a quarter of the turning point
+    double B = state.E - restE;
+    int i_tp = 0;
+    while (i_tp < N - 1 && state.V[i_tp] <= B) {
+      i_tp++;
+    }
+    r_s = min(r_s, 0.25 * state.grid[i_tp]);
+    if (r_s > state.grid[0]) {
+      i_s = min((int)(log(r_s / state.grid[0]) / dx), N - 4);
+    }
+    boundaryDiracSeries(state, i_s, mu, Z, finite ? R : -1, Vc);
+    boundaryDiracAsymptotic(state, mu);
+  } else {
+    boundaryDiracCoulomb(state, mu, Z, finite ? R : -1);
+  }
+  SharedSlice Vmid;
+  function<double(double)> Vfunc;
+  if (shoot_method == RK4_MIDPOINT || shoot_method == ADAMS_MOULTON6) {
+    Vmid = getVmidSlice(state.grid_indices.first + i_s,
+                        state.grid_indices.second - 1);
+  } else if (shoot_method == DORMAND_PRINCE) {
+    Vfunc = [this](double r) {
+      return getV(r);
+    };
+  }
+  double zeta_e = NAN;
+  if (zeta) {
+    zeta_e = boundaryDiracErrorDECoulomb(state.E, state.k, mu);
+  }
+  if (i_s > 0) {
+    // Integrate only the points not covered by the series
+    vector<double> Q(state.Q.begin() + i_s, state.Q.end());
+    vector<double> P(state.P.begin() + i_s, state.P.end());
+    tp = shootDiracLog(Q, P, state.grid.slice(i_s, N), state.V.slice(i_s, N),
+                       state.E, state.k, mu, dx, parallel_legs, shoot_segments,
+                       Vmid, shoot_method, Vfunc, shoot_tol, zeta_e);
+    copy(Q.begin(), Q.end(), state.Q.begin() + i_s);
+    copy(P.begin(), P.end(), state.P.begin() + i_s);
+    tp.i += i_s;
+  } else {
+    tp = shootDiracLog(state.Q, state.P, state.grid, state.V, state.E, state.k,
+                       mu, dx, parallel_legs, shoot_segments, Vmid,
+                       shoot_method, Vfunc, shoot_tol, zeta_e);
+  }
+  shoot_count++;
   LOG(TRACE) << "Integration complete, turning point found at " << tp.i << "\n";
 
   return;
@@ -679,45 +1840,83 @@ void DiracAtom::integrateState(DiracState &state, TurningPoint &tp) {
  * @param  &state:      DiracState to integrate
  * @param  &tp:         TurningPoint object to store turning point info
  * @param  &dE:         Energy correction
- * @param  write_debug: If true, save y and zeta arrays as files for debugging
- * purposes
+ * @param  *ws:         Workspace to reuse for computing dE (see energyStep)
  * @retval
  */
-void DiracAtom::integrateState(DiracState &state, TurningPoint &tp,
-                               double &dE) {
+void DiracAtom::integrateState(DiracState &state, TurningPoint &tp, double &dE,
+                               DiracWorkspace *ws) {
+  integrateState(state, tp, true);
+  dE = energyStep(state, tp, ws);
+}
+
+/**
+ * @brief  Compute the Newton step for the energy of an integrated DiracState
+ * @note   Compute the suggested correction for the energy of a DiracState
+ * that has already been integrated, as the ratio between the mismatch of Q/P
+ * at the turning point and its derivative in E. The state may have been made
+ * continuous and normalised already, as neither changes Q/P. If the
+ * derivative was integrated along with the state (see integrateState), only
+ * its values at the turning point are used; otherwise it is integrated here.
+ * If a workspace is passed, its buffers are used for Q/P and its derivatives,
+ * so that a caller computing many steps in a row only allocates them once.
+ *
+ * @param  &state:      Integrated DiracState
+ * @param  &tp:         TurningPoint returned by the integration
+ * @param  *ws:         Workspace to reuse (default = NULL, use a new one)
+ * @retval              Energy correction dE (the new energy is E-dE)
+ */
+double DiracAtom::energyStep(DiracState &state, TurningPoint &tp,
+                             DiracWorkspace *ws) {
   int N;
   double err;
-  vector<double> y, zetai, zetae;
-
-  integrateState(state, tp);
+  DiracWorkspace ws_local;
 
-  N = state.grid.size();
-  y = vector<double>(N, 0);
-  zetai = vector<double>(N, 0);
-  zetae = vector<double>(N, 0);
+  if (ws == NULL) {
+    ws = &ws_local;
+  }
+  vector<double> &y = ws->y, &zetai = ws->zetai, &zetae = ws->zetae;
 
   err = tp.Qi / tp.Pi - tp.Qe / tp.Pe;
 
-  // Compute the derivative of the error in dE
+  if (!std::isnan(tp.zetai) && !std::isnan(tp.zetae) && !write_debug) {
+    LOG(TRACE) << "Zeta function values at turning point: zetaL = "
+               << tp.zetai << ", zetaR = " << tp.zetae << "\n";
+    LOG(TRACE) << "Q/P error = " << err << "\n";
+    return err / (tp.zetai - tp.zetae);
+  }
+
+  N = state.grid.size();
+  // assign only reallocates if the buffers are too small
+  y.assign(N, 0);
+  zetai.assign(N, 0);
+  zetae.assign(N, 0);
+
+  // Compute the derivative of the error in dE, forward and backwards; y
+  // holds the backwards value at the turning point
   for (int i = 0; i < N; ++i) {
     y[i] = state.Q[i] / state.P[i];
   }
-  // First the forward version
-  y[tp.i] = tp.Qi / tp.Pi;
-  shootDiracErrorDELog(zetai, y, state.grid, state.V, tp.i, state.E, state.k,
-                       mu, dx);
-  // Then the backwards one
   y[tp.i] = tp.Qe / tp.Pe;
   boundaryDiracErrorDECoulomb(zetae, state.E, state.k, mu);
-  shootDiracErrorDELog(zetae, y, state.grid, state.V, tp.i, state.E, state.k,
-                       mu, dx, 'b');
+  auto forward = [&]() {
+    shootDiracErrorDELog(zetai, y, state.grid, state.V, tp.i, state.E, state.k,
+                         mu, dx, 'f', tp.Qi / tp.Pi);
+  };
+  if (parallel_legs) {
+    thread fw(forward);
+    shootDiracErrorDELog(zetae, y, state.grid, state.V, tp.i, state.E, state.k,
+                         mu, dx, 'b');
+    fw.join();
+  } else {
+    forward();
+    shootDiracErrorDELog(zetae, y, state.grid, state.V, tp.i, state.E, state.k,
+                         mu, dx, 'b');
+  }
 
   LOG(TRACE) << "Zeta function values at turning point: zetaL = " << zetai[tp.i]
              << ", zetaR = " << zetae[tp.i] << "\n";
   LOG(TRACE) << "Q/P error = " << err << "\n";
 
-  dE = err / (zetai[tp.i] - zetae[tp.i]);
-
   if (write_debug) {
     string state_name =
       printIupacState(state.getn(), state.getl(), state.gets());
@@ -729,7 +1928,80 @@ void DiracAtom::integrateState(DiracState &state, TurningPoint &tp,
     writeTabulated2ColFile(state.grid, zetae, fname);
   }
 
-  return;
+  return err / (zetai[tp.i] - zetae[tp.i]);
+}
+
+/**
+ * @brief  Integrate several DiracStates of same k at once
+ * @note   Perform a single integration of each of the given DiracStates,
+ * which must all have the same k and be set up with initState. All states are
+ * integrated in a single pass over the union of their grids with
+ * shootDiracLogBatch, with the same results as integrateState. The batch
+ * only implements the default integration method and boundary conditions;
+ * otherwise, the states are integrated one by one with integrateState.
+ *
+ * @param  &states:     DiracStates to integrate
+ * @param  &tps:        Will contain the TurningPoint for each state
+ * @param  *ws:         Workspace to reuse (default = NULL, use a new one)
+ * @retval None
+ */
+void DiracAtom::integrateStates(vector<DiracState> &states,
+                                vector<TurningPoint> &tps,
+                                DiracWorkspace *ws) {
+  int L = states.size();
+  int i0 = INT_MAX, i1 = INT_MIN, k;
+  vector<double> E(L);
+  vector<pair<int, int>> lims(L);
+
+  if (L == 0) {
+    tps.clear();
+    return;
+  }
+
+  if (shoot_method != RK4_AVERAGED || series_boundaries) {
+    tps.resize(L);
+    for (int l = 0; l < L; ++l) {
+      integrateState(states[l], tps[l]);
+    }
+    return;
+  }
+
+  k = states[0].k;
+  for (int l = 0; l < L; ++l) {
+    if (states[l].grid.size() == 0) {
+      throw runtime_error("Can not integrate state with zero-sized grid");
+    }
+    if (states[l].k != k) {
+      throw invalid_argument("integrateStates requires states with same k");
+    }
+    i0 = min(i0, states[l].grid_indices.first);
+    i1 = max(i1, states[l].grid_indices.second);
+  }
+
+  LOG(TRACE) << "Integrating " << L << " states with joint grid of size "
+             << i1 - i0 + 1 << "\n";
+
+  SharedSlice r, logr, V;
+  vector<vector<double>> Q(L), P(L);
+  getGridSlices(i0, i1, r, logr, V);
+
+  // The states lend their own arrays to the batch
+  for (int l = 0; l < L; ++l) {
+    DiracState &st = states[l];
+    boundaryDiracCoulomb(st, mu, Z, R > st.grid[0] ? R : -1);
+    Q[l].swap(st.Q);
+    P[l].swap(st.P);
+    E[l] = st.E;
+    lims[l] = make_pair(st.grid_indices.first - i0, st.grid_indices.second - i0);
+  }
+
+  tps = shootDiracLogBatch(Q, P, r, V, E, lims, k, mu, dx, ws);
+  shoot_count += L;
+
+  for (int l = 0; l < L; ++l) {
+    states[l].Q.swap(Q[l]);
+    states[l].P.swap(P[l]);
+  }
 }
 
 /**
@@ -737,11 +2009,13 @@ void DiracAtom::integrateState(DiracState &state, TurningPoint &tp,
  * @note   Converge a state of given n and k, searching for the
  * correct energy through an iterative process.
  *
- * @param  n:   Principal quantum number
- * @param  k:   Dirac quantum number
- * @retval      Converged state
+ * @param  n:       Principal quantum number
+ * @param  k:       Dirac quantum number
+ * @param  *phases: Pruefer phases sampled so far for this k, shared between
+ * states (default NULL, see convergeNodesPhase)
+ * @retval          Converged state
  */
-DiracState DiracAtom::convergeState(int n, int k) {
+DiracState DiracAtom::convergeState(int n, int k, map<double, double> *phases) {
   int l;
   bool s;
   int targ_nodes;
@@ -775,12 +2049,134 @@ DiracState DiracAtom::convergeState(int n, int k) {
   // Compute the required number of nodes
   qnumDirac2Schro(k, l, s);
   qnumPrincipal2Nodes(n, l, targ_nodes);
+  long shoot_start = shoot_count;
 
   // Find energy limits
   Elim = energyLimits(targ_nodes, k);
   minE = Elim.first;
   maxE = Elim.second;
 
+  // Start from the state found before the last change of potential or grid,
+  // if any, within a bracket halfway to the neighbouring states it had
+  DiracState warm;
+  double wminE = minE, wmaxE = maxE;
+  {
+    lock_guard<mutex> lock(*states_mutex);
+    auto it = warm_states.find(make_tuple(n, l, s));
+    if (it != warm_states.end()) {
+      warm = it->second;
+      it = warm_states.find(make_tuple(n - 1, l, s));
+      if (it != warm_states.end()) {
+        wminE = max(wminE, (it->second.E + warm.E) / 2.0);
+      }
+      it = warm_states.find(make_tuple(n + 1, l, s));
+      if (it != warm_states.end()) {
+        wmaxE = min(wmaxE, (it->second.E + warm.E) / 2.0);
+      }
+    }
+  }
+  if (warm.converged && warm.nodes == targ_nodes && warm.E > wminE &&
+      warm.E < wmaxE) {
+    state.k = k;
+    state.E = warm.E;
+    int i0 = warm.grid_indices.first, i1 = warm.grid_indices.second;
+    if (warm.grid[0] == rc * exp(i0 * dx) &&
+        warm.grid[warm.size() - 1] == rc * exp(i1 * dx)) {
+      // Same grid: correct the energy to first order in the change of
+      // potential
+      SharedSlice r, logr, V;
+      vector<double> dV(warm.size());
+      getGridSlices(i0, i1, r, logr, V);
+      for (int i = 0; i < warm.size(); ++i) {
+        dV[i] = V[i] - warm.V[i];
+      }
+      double Ep = warm.E + braOpKetLog(vector<vector<double>> {warm.P, warm.Q},
+                                       dV, {warm.P, warm.Q}, r, dx);
+      if (Ep > wminE && Ep < wmaxE) {
+        state.E = Ep;
+      }
+    }
+    try {
+      convergeE(state, tp, wminE, wmaxE);
+    } catch (const runtime_error &re) {
+      state.nodes = -1;
+    }
+    if (state.nodes == targ_nodes) {
+      state.normalize();
+      state.converged = true;
+
+      LOG(INFO) << "State with n = " << n << ", k = " << k
+                << " converged from previous solution, "
+                << shoot_count - shoot_start << " integrations\n";
+
+      if (target_accuracy > 0) {
+        refineState(state, n);
+      } else if (richardson_levels > 1) {
+        extrapolateState(state, n);
+      }
+
+      return state;
+    }
+    LOG(DEBUG) << "Warm start from previous solution failed, converging "
+               "state with n = " << n << ", k = " << k << " from scratch\n";
+    state = DiracState();
+  }
+
+  if (multigrid_factor > 1) {
+    // Bracket the nodes and roughly converge the energy on a coarser grid,
+    // then only refine it here
+    shared_ptr<DiracAtom> coarse = coarseAtom();
+    pair<double, double> cElim = coarse->energyLimits(targ_nodes, k);
+    bool bracketed = false;
+    state.k = k;
+    try {
+      if (pruefer_nodes) {
+        coarse->convergeNodesPhase(state, tp, targ_nodes, cElim.first,
+                                   cElim.second);
+      } else {
+        coarse->convergeNodes(state, tp, targ_nodes, cElim.first,
+                              cElim.second);
+      }
+      bracketed = true;
+      coarse->convergeE(state, tp, cElim.first, cElim.second,
+                        (Esearch == SAFE_NEWTON));
+    } catch (const runtime_error &re) {
+      // If only the energy search failed, its last estimate is still good
+      // enough to start from
+    }
+    if (bracketed) {
+      LOG(TRACE) << "Energy on coarse grid: " << state.E - restE << " + mc2\n";
+      try {
+        convergeE(state, tp, minE, maxE);
+      } catch (const runtime_error &re) {
+        state.nodes = -1;
+      }
+    } else {
+      state.nodes = -1;
+    }
+    if (state.nodes == targ_nodes) {
+      state.normalize();
+      state.converged = true;
+
+      LOG(INFO) << "State with n = " << n << ", k = " << k
+                << " converged from coarse grid, " << shoot_count - shoot_start
+                << " integrations\n";
+
+      if (target_accuracy > 0) {
+        refineState(state, n);
+      } else if (richardson_levels > 1) {
+        extrapolateState(state, n);
+      }
+
+      return state;
+    }
+    LOG(DEBUG) << "Warm start from coarse grid failed, converging state with "
+               "n = " << n << ", k = " << k << " from scratch\n";
+    state = DiracState();
+    minE = Elim.first;
+    maxE = Elim.second;
+  }
+
   LOG(DEBUG) << "Converging state with n = " << n << ", k = " << k << "\n";
   LOG(DEBUG) << "Energy limits: " << minE - restE << " + mc2 < E < "
              << maxE - restE << " + mc2\n";
@@ -790,17 +2186,22 @@ DiracState DiracAtom::convergeState(int n, int k) {
                << "+mc2, maxE = " << maxE - restE << "+mc2\n";
     state.k = k;
     // Find appropriate basin
-    convergeNodes(state, tp, targ_nodes, minE, maxE);
+    if (pruefer_nodes) {
+      convergeNodesPhase(state, tp, targ_nodes, minE, maxE, phases);
+    } else {
+      convergeNodes(state, tp, targ_nodes, minE, maxE);
+    }
     // Now converge energy
+    bool integrated = (Esearch == SAFE_NEWTON);
     double hydroE = hydrogenicDiracEnergy(Z, mu, n, k);
-    if (it == 0 && hydroE > minE && hydroE < maxE) {
+    if (!integrated && it == 0 && hydroE > minE && hydroE < maxE) {
       // We only try this the first time; if it fails, it ain't working any
       // better later...
       LOG(TRACE) << "Using hydrogenic Dirac energy " << hydroE - restE
                  << " + mc2 as starting guess\n";
       state.E = hydroE; // Speeds up things a lot when we got a broad interval
     }
-    convergeE(state, tp, minE, maxE);
+    convergeE(state, tp, minE, maxE, integrated);
 
     // Check node condition
     if (state.nodes != targ_nodes) {
@@ -815,7 +2216,10 @@ DiracState DiracAtom::convergeState(int n, int k) {
       // Store it for the future
       state.normalize();
       state.converged = true;
-      states[make_tuple(n, l, s)] = state;
+      {
+        lock_guard<mutex> lock(*states_mutex);
+        states[make_tuple(n, l, s)] = state;
+      }
       state = DiracState();
     } else {
       state.normalize();
@@ -823,6 +2227,15 @@ DiracState DiracAtom::convergeState(int n, int k) {
 
       LOG(TRACE) << "Convergence achieved at E = " << state.E - restE
                  << " + mc2\n";
+      LOG(INFO) << "State with n = " << n << ", k = " << k << " converged in "
+                << it + 1 << " iterations, " << shoot_count - shoot_start
+                << " integrations\n";
+
+      if (target_accuracy > 0) {
+        refineState(state, n);
+      } else if (richardson_levels > 1) {
+        extrapolateState(state, n);
+      }
 
       // And return
       return state;
@@ -832,6 +2245,250 @@ DiracState DiracAtom::convergeState(int n, int k) {
   throw runtime_error("Failed to converge with convergeState");
 }
 
+/**
+ * @brief  Copy this atom onto a different grid
+ * @note   Make a copy of this atom with the same central radius and grid step
+ * newdx, with its own locks, tables and states, used to solve the same states
+ * on coarser or finer grids. The copy does no extrapolation, refinement or
+ * multigrid search of its own, and does not use the on-disk cache. The caller must hold
+ * states_mutex.
+ *
+ * @param  newdx:   Grid step of the copy
+ * @retval          Copied atom
+ */
+shared_ptr<DiracAtom> DiracAtom::gridCopy(double newdx) {
+  shared_ptr<DiracAtom> copy;
+  {
+    lock_guard<mutex> vlock(*Vtable_mutex);
+    copy = make_shared<DiracAtom>(*this);
+  }
+  copy->states_mutex = make_shared<mutex>();
+  copy->Vtable_mutex = make_shared<mutex>();
+  copy->grid_atoms.clear();
+  copy->richardson_levels = 1;
+  copy->target_accuracy = 0;
+  copy->coarse_atom = nullptr;
+  copy->multigrid_factor = 1;
+  copy->cache_dir = "";
+  copy->write_debug = false;
+  copy->setgrid(rc, newdx);
+  copy->warm_states.clear();
+
+  return copy;
+}
+
+/**
+ * @brief  Get the atom used for a level of grid refinement
+ * @note   Get a copy of this atom with grid step dx/2^level, used by
+ * extrapolateState and refineState. The copies are made when first needed
+ * and kept, so that their tabulated potential is computed only once; they are
+ * discarded by reset.
+ *
+ * @param  level:   Level of refinement (1 for dx/2, 2 for dx/4..., -1 for
+ *                  2*dx)
+ * @retval          Refined atom
+ */
+shared_ptr<DiracAtom> DiracAtom::gridAtom(int level) {
+  lock_guard<mutex> lock(*states_mutex);
+
+  if (grid_atoms.find(level) == grid_atoms.end()) {
+    grid_atoms[level] = gridCopy(dx / pow(2, level));
+  }
+
+  return grid_atoms[level];
+}
+
+/**
+ * @brief  Get the atom used for the coarse stage of convergeState
+ * @note   Get a copy of this atom with grid step dx*multigrid_factor, on
+ * which convergeState brackets the nodes and converges a first estimate of
+ * the energy. The copy is made when first needed and discarded by reset.
+ *
+ * @retval          Coarse atom
+ */
+shared_ptr<DiracAtom> DiracAtom::coarseAtom() {
+  lock_guard<mutex> lock(*states_mutex);
+
+  if (!coarse_atom || coarse_atom->getdx() != dx * multigrid_factor) {
+    coarse_atom = gridCopy(dx * multigrid_factor);
+    coarse_atom->Etol = max(Etol, COARSE_ETOL);
+    coarse_atom->maxit_E = min(maxit_E, COARSE_MAXIT_E);
+  }
+
+  return coarse_atom;
+}
+
+/**
+ * @brief  Converge a state starting from a known energy
+ * @note   Converge the state of given n and k on this atom starting from an
+ * energy found for it on another grid, which is normally already within the
+ * right basin; if the result does not have the right number of nodes, the
+ * state is converged from scratch.
+ *
+ * @param  n:       Principal quantum number
+ * @param  k:       Dirac quantum number
+ * @param  E:       Starting energy
+ * @retval          Converged energy
+ */
+double DiracAtom::warmEnergy(int n, int k, double E) {
+  int l, targ_nodes;
+  bool s;
+  DiracState state;
+  TurningPoint tp;
+
+  qnumDirac2Schro(k, l, s);
+  qnumPrincipal2Nodes(n, l, targ_nodes);
+
+  pair<double, double> Elim = energyLimits(targ_nodes, k);
+  state.k = k;
+  state.E = E;
+  try {
+    convergeE(state, tp, Elim.first, Elim.second);
+  } catch (const runtime_error &re) {
+    state.nodes = -1;
+  }
+  if (state.nodes != targ_nodes) {
+    LOG(DEBUG) << "Warm start failed on grid with dx = " << dx
+               << ", converging state from scratch\n";
+    state = convergeState(n, k);
+  }
+
+  return state.E;
+}
+
+/**
+ * @brief  Order of the error of the integration method
+ * @note   Order p of the error of the energies found with shoot_method, which
+ * goes as dx^p: 2 for RK4, whose averaged coefficients dominate the error for
+ * a finite size nucleus, 4 for RK4_MIDPOINT and 6 for AM6.
+ *
+ * @retval          Order of the error
+ */
+double DiracAtom::methodOrder() {
+  switch (shoot_method) {
+    case RK4_MIDPOINT:
+      return 4;
+    case ADAMS_MOULTON6:
+      return 6;
+    default:
+      return 2;
+  }
+}
+
+/**
+ * @brief  Extrapolate the energy of a state to an infinitely fine grid
+ * @note   Converge the same state again on grids with step dx/2 and, if
+ * richardson_levels is 3, dx/4, each starting from the energy found on the
+ * previous one, and replace the energy of the state with the Richardson
+ * extrapolation of the series,
+ *
+ *      E = E_f + (E_f - E_c)/(2^p - 1)
+ *
+ * where E_c and E_f are the energies on the two finest grids and p is the
+ * order of the error of the integration method (see methodOrder). With two
+ * grids the size of the correction is stored as the error estimate E_err;
+ * with three, the difference between the extrapolations from the two coarser
+ * and the two finer grids, which is much smaller when the error does go as
+ * dx^p. The wavefunction is kept on the original grid, so that it can still
+ * be combined with the other states.
+ *
+ * @param  &state:  Converged state
+ * @param  n:       Principal quantum number of the state
+ * @retval None
+ */
+void DiracAtom::extrapolateState(DiracState &state, int n) {
+  int levels = min(richardson_levels, 3);
+  vector<double> Es = {state.E};
+
+  if (shoot_method == DORMAND_PRINCE) {
+    LOG(WARNING) << "Richardson extrapolation is not used with DOPRI5, whose "
+                 "error does not depend on the grid step\n";
+    return;
+  }
+
+  for (int lev = 1; lev < levels; ++lev) {
+    Es.push_back(gridAtom(lev)->warmEnergy(n, state.k, Es.back()));
+  }
+
+  double p = methodOrder();
+  double Ef = Es.back(), Ec = Es[Es.size() - 2];
+  state.E = Ef + (Ef - Ec) / (pow(2, p) - 1);
+  if (levels == 3) {
+    state.E_err = abs(state.E - (Ec + (Ec - Es[0]) / (pow(2, p) - 1)));
+    LOG(DEBUG) << "Observed order of convergence: "
+               << log2((Es[0] - Es[1]) / (Es[1] - Es[2])) << "\n";
+  } else {
+    state.E_err = abs(state.E - Ef);
+  }
+
+  LOG(INFO) << "Extrapolated energy of state with n = " << n << ", k = "
+            << state.k << ": " << (state.E - restE) / Physical::eV
+            << " + mc2 eV, estimated error " << state.E_err / Physical::eV
+            << " eV\n";
+}
+
+/**
+ * @brief  Refine the energy of a state until it meets target_accuracy
+ * @note   Estimate the discretisation error of the energy of a state by step
+ * doubling, and refine the grid only as far as needed for it to be below half
+ * of target_accuracy, so that every transition between two states meets the
+ * target. The estimate first compares the energy with the one on a grid with
+ * step 2*dx, which is cheap, as long as that step is no larger than
+ * MAX_DOUBLING_DX; if that is not enough, the state is converged
+ * again on grids with step dx/2, dx/4... up to dx/2^MAX_REFINE_LEVEL, each
+ * starting from the energy found on the previous one. The energy on the
+ * finest grid E_f is extrapolated with the one on the grid before, E_c, as
+ * in extrapolateState, and the size of the correction (E_f - E_c)/(2^p - 1),
+ * which estimates the error left on E_f, is stored as E_err. The wavefunction
+ * is kept on the original grid.
+ *
+ * @param  &state:  Converged state
+ * @param  n:       Principal quantum number of the state
+ * @retval None
+ */
+void DiracAtom::refineState(DiracState &state, int n) {
+  double tol = target_accuracy / 2;
+  double p = methodOrder();
+
+  if (shoot_method == DORMAND_PRINCE) {
+    // The error only depends on shoot_tol
+    return;
+  }
+
+  double Ec = state.E, Ef = state.E, err = INFINITY;
+  if (2 * dx <= MAX_DOUBLING_DX) {
+    try {
+      Ec = gridAtom(-1)->warmEnergy(n, state.k, state.E);
+      err = abs(Ef - Ec) / (pow(2, p) - 1);
+    } catch (const runtime_error &re) {
+      LOG(DEBUG) << "Could not converge state on grid with dx = " << 2 * dx
+                 << ", refining\n";
+      Ec = Ef;
+    }
+  }
+  int lev = 0;
+  while (err > tol && lev < MAX_REFINE_LEVEL) {
+    ++lev;
+    Ec = Ef;
+    Ef = gridAtom(lev)->warmEnergy(n, state.k, Ec);
+    err = abs(Ef - Ec) / (pow(2, p) - 1);
+  }
+
+  state.E = Ef + (Ef - Ec) / (pow(2, p) - 1);
+  state.E_err = err;
+
+  if (err > tol) {
+    LOG(WARNING) << "State with n = " << n << ", k = " << state.k
+                 << " did not reach the target accuracy, estimated error "
+                 << err / Physical::eV << " eV with dx = "
+                 << dx / pow(2, lev) << "\n";
+  }
+  LOG(INFO) << "Refined energy of state with n = " << n << ", k = "
+            << state.k << " on grid with dx = " << dx / pow(2, lev) << ": "
+            << (state.E - restE) / Physical::eV << " + mc2 eV, estimated error "
+            << state.E_err / Physical::eV << " eV\n";
+}
+
 /**
  * @brief  Search for an orbital with given set of quantum numbers
  * @note   Search for a Dirac orbital for this Atom with a given set of
@@ -855,11 +2512,24 @@ void DiracAtom::calcState(int n, int l, bool s, bool force) {
   TurningPoint tp;
 
   qnumSchro2Dirac(l, s, k);
+  qnumDirac2Schro(k, l, s); // Same key for both spins when l = 0
 
   // First, check if it's already calculated
-  if (!force && states[make_tuple(n, l, s)].converged) {
-    LOG(DEBUG) << "State with n = " << n << ", k = " << k
-               << " already calculated\n";
+  if (!force) {
+    lock_guard<mutex> lock(*states_mutex);
+    if (!cache_loaded) {
+      loadStateCache();
+    }
+    if (states[make_tuple(n, l, s)].converged) {
+      LOG(DEBUG) << "State with n = " << n << ", k = " << k
+                 << " already calculated\n";
+      return;
+    }
+  }
+
+  if (solver == BSPLINE && !(idshell > 0 && n >= idshell)) {
+    // One diagonalisation gives all the states below too
+    calcKappaSeries(k, n, force);
     return;
   }
 
@@ -869,9 +2539,326 @@ void DiracAtom::calcState(int n, int l, bool s, bool force) {
     LOG(ERROR) << "Convergence failed with error: " << re.what() << "\n";
   }
 
+  lock_guard<mutex> lock(*states_mutex);
   states[make_tuple(n, l, s)] = state;
 }
 
+/**
+ * @brief  Calculate all states with a given k up to a given n
+ * @note   Calculate the whole series of states with quantum number k, from
+ * the lowest one up to principal quantum number max_n, in order of increasing
+ * energy. When pruefer_nodes is set, the Pruefer phase is a single monotonic
+ * function of the energy for all the states in the series, so every sample
+ * taken while searching for one of them is kept, and used to bracket the
+ * following ones. The first sample for each state after the lowest is taken
+ * at the energy predicted by the quantum defect of the previous one, which
+ * usually falls already within its basin and is a good starting point for
+ * convergeE. If solver is BSPLINE, the whole series comes instead from a single
+ * diagonalisation (see solveKappaBSpline). Failures are logged and leave the
+ * state unconverged, as in calcState.
+ *
+ * @param  k:       Quantum number k
+ * @param  max_n:   Maximum value of principal quantum number
+ * @param  force:   If true, force recalculation of the orbitals even if already
+ * present
+ * @retval None
+ */
+void DiracAtom::calcKappaSeries(int k, int max_n, bool force) {
+  int l;
+  bool s;
+  map<double, double> phases;
+  long shoot_start = shoot_count;
+
+  qnumDirac2Schro(k, l, s);
+
+  if (!force) {
+    lock_guard<mutex> lock(*states_mutex);
+    if (!cache_loaded) {
+      loadStateCache();
+    }
+  }
+
+  if (solver == BSPLINE) {
+    vector<DiracState> series;
+    try {
+      series = solveKappaBSpline(k, max_n);
+    } catch (const runtime_error &re) {
+      LOG(ERROR) << "Diagonalisation failed with error: " << re.what() << "\n";
+      return;
+    }
+    for (int n = l + 1; n <= max_n; ++n) {
+      DiracState state = series[n - l - 1];
+      if (!force) {
+        lock_guard<mutex> lock(*states_mutex);
+        if (states[make_tuple(n, l, s)].converged) {
+          continue;
+        }
+      }
+      if (idshell > 0 && n >= idshell) {
+        state = convergeState(n, k);
+      }
+      lock_guard<mutex> lock(*states_mutex);
+      states[make_tuple(n, l, s)] = state;
+    }
+    return;
+  }
+
+  for (int n = l + 1; n <= max_n; ++n) {
+    DiracState state;
+
+    if (!force) {
+      lock_guard<mutex> lock(*states_mutex);
+      if (states[make_tuple(n, l, s)].converged) {
+        LOG(DEBUG) << "State with n = " << n << ", k = " << k
+                   << " already calculated\n";
+        continue;
+      }
+    }
+
+    try {
+      if (pruefer_nodes && n > l + 1) {
+        // Sample first where the quantum defect of the previous state
+        // suggests the next one will be
+        DiracState prev;
+        {
+          lock_guard<mutex> lock(*states_mutex);
+          prev = states[make_tuple(n - 1, l, s)];
+        }
+        if (prev.converged && prev.E < restE) {
+          double d = n - 1 - Z * sqrt(mu / (2 * (restE - prev.E)));
+          double E = restE - pow(Z / (n - d), 2) * mu / 2;
+          phases[E] = phaseCount(E, k);
+        }
+      }
+      state = convergeState(n, k, &phases);
+    } catch (const runtime_error &re) {
+      LOG(ERROR) << "Convergence failed with error: " << re.what() << "\n";
+    }
+
+    lock_guard<mutex> lock(*states_mutex);
+    states[make_tuple(n, l, s)] = state;
+  }
+
+  LOG(INFO) << "Series of states with k = " << k << " up to n = " << max_n
+            << " computed with " << shoot_count - shoot_start
+            << " integrations\n";
+}
+
+/**
+ * @brief  Solve for all states with a given k up to a given n by
+ * diagonalisation in a B-spline basis
+ * @note   Expand P and Q in a dual kinetic balance basis of bspline_size
+ * B-splines of order bspline_order (see dkbDiracMatrices), and find all the
+ * bound states with quantum number k at once as eigenvectors of the resulting
+ * banded generalised eigenvalue problem. The knots are placed on points of
+ * the logarithmic grid, evenly spaced between a thousandth of the nuclear
+ * radius (or of the Bohr radius, if smaller) and the outer radius of the
+ * hydrogen-like state with principal quantum number max_n+1, plus a knot at
+ * the origin. The states are then evaluated on the same grid that would be
+ * used by the shooting method.
+ * Bound states are identified as eigenvalues between -mc^2 and zero, which
+ * excludes the negative energy continuum, and assigned to n in order of
+ * energy.
+ *
+ * @param  k:       Quantum number k
+ * @param  max_n:   Maximum value of principal quantum number
+ * @retval          States from the lowest one up to max_n; those that were not
+ * found are left unconverged
+ */
+vector<DiracState> DiracAtom::solveKappaBSpline(int k, int max_n) {
+  int l, n0, i_in, i_out, nint;
+  bool s;
+  double r_in;
+  vector<double> knots, rq, wq, Vq, evals;
+  vector<vector<double>> H, S, evecs;
+  vector<DiracState> series;
+
+  qnumDirac2Schro(k, l, s);
+  n0 = l + 1;
+  series = vector<DiracState>(max(max_n - n0 + 1, 0));
+  if (series.size() == 0) {
+    return series;
+  }
+
+  // The first knot is placed well inside the nucleus (or the Bohr radius, for
+  // a point nucleus), where the wavefunction is already regular; knots much
+  // closer to the origin only make the overlap matrix ill-conditioned
+  r_in = 1e-3 * ((R > 0) ? min(R, 1.0 / (Z * mu)) : 1.0 / (Z * mu));
+  i_in = (int)floor(log(r_in / rc) / dx);
+  i_out = gridLimits(hydrogenicDiracEnergy(Z, mu, max_n + 1, k), k).second;
+  nint = bspline_size - bspline_order;
+  if (nint < 2) {
+    throw runtime_error("bspline_size must be larger than bspline_order + 1");
+  }
+  if (i_out <= i_in) {
+    throw runtime_error("Invalid range for B-spline knots");
+  }
+
+  knots = vector<double>(bspline_order, 0.0);
+  for (int j = 0; j < nint; ++j) {
+    int i = i_in + (int)round(j * (i_out - i_in) / (double)nint);
+    double r = rc * exp(i * dx);
+    if (r > knots.back()) {
+      knots.push_back(r);
+    }
+  }
+  for (int j = 0; j < bspline_order; ++j) {
+    knots.push_back(rc * exp(i_out * dx));
+  }
+
+  BSplineBasis basis(knots, bspline_order);
+  basis.quadrature(bspline_order + 4, rq, wq);
+  Vq = getV(rq);
+
+  LOG(DEBUG) << "Solving states with k = " << k << " in a basis of "
+             << basis.size() << " B-splines, " << knots[bspline_order]
+             << " < r < " << knots.back() << "\n";
+
+  dkbDiracMatrices(basis, rq, wq, Vq, k, mu, H, S);
+  generalizedBandEigen(H, S, evals, evecs);
+
+  int n = n0;
+  for (int j = 0; j < (int)evals.size() && n <= max_n; ++j) {
+    if (evals[j] <= -restE || evals[j] >= 0) {
+      continue;
+    }
+
+    DiracState &state = series[n - n0];
+    int targ_nodes;
+    double fmax = 0;
+
+    state = initState(evals[j] + restE, k);
+    dkbDiracWavefunction(basis, evecs[j], k, mu, state.grid, state.P, state.Q);
+    // Same sign convention as boundaryDiracCoulomb: the dominant component
+    // at the origin is P > 0 for k < 0 and Q < 0 for k > 0
+    vector<double> &f = (k < 0) ? state.P : state.Q;
+    double fsign = (k < 0) ? 1 : -1;
+    for (int i = 0; i < (int)f.size(); ++i) {
+      fmax = max(fmax, abs(f[i]));
+    }
+    for (int i = 0; i < (int)f.size(); ++i) {
+      if (abs(f[i]) > 1e-3 * fmax) {
+        if (f[i] * fsign < 0) {
+          for (int i2 = 0; i2 < (int)state.P.size(); ++i2) {
+            state.P[i2] = -state.P[i2];
+            state.Q[i2] = -state.Q[i2];
+          }
+        }
+        break;
+      }
+    }
+    state.normalize();
+    state.findNodes(nodetol);
+    state.converged = true;
+
+    qnumPrincipal2Nodes(n, l, targ_nodes);
+    if (state.nodes != targ_nodes) {
+      LOG(WARNING) << "State with n = " << n << ", k = " << k << " found by "
+                   << "diagonalisation has " << state.nodes << " nodes instead of "
+                   << targ_nodes << "\n";
+    }
+
+    ++n;
+  }
+
+  LOG(INFO) << "Series of states with k = " << k << " up to n = " << max_n
+            << " found with a basis of " << basis.size() << " B-splines\n";
+
+  return series;
+}
+
+/**
+ * @brief  Calculate a list of states, in parallel if required
+ * @note   Calculate all the states with the given quantum numbers, using
+ * nthreads worker threads. States are grouped in chains sharing the same l
+ * and s, and each chain is solved by a single worker in order of increasing n,
+ * so that energyLimits can always make use of the lower states that have
+ * already converged; chains with more than one state are solved with
+ * calcKappaSeries, which also computes any state missing in between. Chains
+ * are handed out longest first. Failures are logged
+ * and leave the state unconverged, so that a later getState can report them.
+ *
+ * @param  qnums:   List of quantum numbers (n, l, s) of the states to compute
+ * @param  force:   If true, force recalculation of the orbitals even if already
+ * present
+ * @retval None
+ */
+void DiracAtom::calcStates(vector<tuple<int, int, bool>> qnums, bool force) {
+  map<pair<int, bool>, vector<int>> chainmap;
+  vector<pair<pair<int, bool>, vector<int>>> chains;
+  atomic<int> next_chain(0);
+
+  for (int i = 0; i < (int)qnums.size(); ++i) {
+    int k, l;
+    bool s;
+    qnumSchro2Dirac(get<1>(qnums[i]), get<2>(qnums[i]), k);
+    qnumDirac2Schro(k, l, s);
+    vector<int> &ns = chainmap[make_pair(l, s)];
+    if (!vectorContains(ns, get<0>(qnums[i]))) {
+      ns.push_back(get<0>(qnums[i]));
+    }
+  }
+  for (auto it = chainmap.begin(); it != chainmap.end(); ++it) {
+    sort(it->second.begin(), it->second.end());
+    chains.push_back(*it);
+  }
+  sort(chains.begin(), chains.end(),
+  [](const pair<pair<int, bool>, vector<int>> &c1,
+  const pair<pair<int, bool>, vector<int>> &c2) {
+    return c1.second.size() > c2.second.size();
+  });
+
+  auto worker = [&]() {
+    int ic;
+    while ((ic = next_chain++) < (int)chains.size()) {
+      int l = chains[ic].first.first;
+      bool s = chains[ic].first.second;
+      if (chains[ic].second.size() > 1) {
+        int k;
+        qnumSchro2Dirac(l, s, k);
+        try {
+          calcKappaSeries(k, chains[ic].second.back(), force);
+        } catch (AtomErrorCode aerr) {
+          LOG(DEBUG) << "Calculation of series with k = " << k
+                     << " failed with AtomErrorCode " << aerr << "\n";
+        } catch (...) {
+          LOG(DEBUG) << "Calculation of series with k = " << k << " failed\n";
+        }
+        continue;
+      }
+      for (int j = 0; j < (int)chains[ic].second.size(); ++j) {
+        int n = chains[ic].second[j];
+        try {
+          calcState(n, l, s, force);
+        } catch (AtomErrorCode aerr) {
+          LOG(DEBUG) << "Calculation of state " << printIupacState(n, l, s)
+                     << " failed with AtomErrorCode " << aerr << "\n";
+        } catch (...) {
+          LOG(DEBUG) << "Calculation of state " << printIupacState(n, l, s)
+                     << " failed\n";
+        }
+      }
+    }
+  };
+
+  int nt = max(1, min(nthreads, (int)chains.size()));
+  LOG(INFO) << "Computing " << chains.size() << " chains of states with " << nt
+            << " threads\n";
+
+  if (nt == 1) {
+    worker();
+    return;
+  }
+
+  vector<thread> pool;
+  for (int i = 0; i < nt; ++i) {
+    pool.push_back(thread(worker));
+  }
+  for (int i = 0; i < nt; ++i) {
+    pool[i].join();
+  }
+}
+
 /**
  * @brief  Calculate all states up to a given n
  * @note   Calculate all states up to a given quantum number n,
@@ -883,20 +2870,103 @@ void DiracAtom::calcState(int n, int l, bool s, bool force) {
  * @retval None
  */
 void DiracAtom::calcAllStates(int max_n, bool force) {
+  vector<tuple<int, int, bool>> qnums;
+
   for (int n = 1; n <= max_n; ++n) {
     for (int l = 0; l < n; ++l) {
       for (int s = 0; s < 2; ++s) {
-        calcState(n, l, bool(s), force);
+        qnums.push_back(make_tuple(n, l, bool(s)));
+      }
+    }
+  }
+
+  calcStates(qnums, force);
+}
+
+/**
+ * @brief  Add the perturbative corrections to the energy of a state
+ * @note   Add to the energy of a state found with the nuclear potential alone
+ * the first order correction due to the Uehling and electronic background
+ * terms dV:
+ *
+ * dE1 = <psi|dV|psi>
+ *
+ * If perturbative_tol is larger than zero, the size of the second order
+ * correction is also estimated in the closure approximation, using the gap to
+ * the closest hydrogen-like state with the same k:
+ *
+ * |dE2| ~ (<psi|dV^2|psi> - dE1^2) / gap
+ *
+ * It is added to the estimated error E_err, and a warning is printed if it
+ * exceeds perturbative_tol. The wavefunction is left unchanged. The
+ * corrections are computed only once for each state, and kept until the
+ * states or the corrections are reset.
+ *
+ * @param  state:   State to correct
+ * @param  n:       Principal quantum number of the state
+ * @retval None
+ */
+void DiracAtom::correctState(DiracState &state, int n) {
+  int l;
+  bool s, found;
+  pair<double, double> corr;
+
+  qnumDirac2Schro(state.k, l, s);
+  tuple<int, int, bool> key = make_tuple(n, l, s);
+  {
+    lock_guard<mutex> lock(*states_mutex);
+    auto it = corrections.find(key);
+    found = (it != corrections.end());
+    if (found) {
+      corr = it->second;
+    }
+  }
+
+  if (!found) {
+    vector<double> r = state.grid;
+    vector<vector<double>> psi = {state.P, state.Q};
+    vector<double> dV = getVCorrectionSlice(state.grid_indices.first,
+                                            state.grid_indices.second);
+    vector<double> dV2(dV.size());
+
+    for (int i = 0; i < (int)dV.size(); ++i) {
+      dV2[i] = dV[i] * dV[i];
+    }
+
+    corr.first = braOpKetLog(psi, dV, psi, r, dx);
+    corr.second = 0;
+    if (perturbative_tol > 0) {
+      double En = hydrogenicDiracEnergy(Z, mu, n, state.k);
+      double gap = hydrogenicDiracEnergy(Z, mu, n + 1, state.k) - En;
+      if (n > l + 1) {
+        gap = min(gap, En - hydrogenicDiracEnergy(Z, mu, n - 1, state.k));
+      }
+      corr.second = (braOpKetLog(psi, dV2, psi, r, dx) - pow(corr.first, 2)) / gap;
+      if (corr.second > perturbative_tol) {
+        LOG(WARNING) << "Second order correction to the energy of state "
+                     << printIupacState(n, l, s) << " estimated at "
+                     << corr.second / Physical::eV
+                     << " eV; the perturbative corrections may be inaccurate\n";
       }
     }
+    LOG(DEBUG) << "Perturbative correction to the energy of state "
+               << printIupacState(n, l, s) << ": " << corr.first / Physical::eV
+               << " eV\n";
+
+    lock_guard<mutex> lock(*states_mutex);
+    corrections[key] = corr;
   }
+
+  state.E += corr.first;
+  state.E_err += corr.second;
 }
 
 /**
  * @brief  Return an orbital with given set of quantum numbers
  * @note   Search for a Dirac orbital for this Atom with a given set of
  * quantum numbers. If the state has already been calculated and stored, return
- * it. Otherwise, calculate it, then return it.
+ * it. Otherwise, calculate it, then return it. With PERTURBATIVE_CORRECTIONS,
+ * the returned energy includes the corrections (see correctState).
  *
  * @param  n: Principal quantum number
  * @param  l: Orbital quantum number
@@ -904,13 +2974,26 @@ void DiracAtom::calcAllStates(int max_n, bool force) {
  * @retval Requested orbital
  */
 DiracState DiracAtom::getState(int n, int l, bool s) {
+  int k;
+  DiracState st;
+
+  qnumSchro2Dirac(l, s, k);
+  qnumDirac2Schro(k, l, s);
   calcState(n, l, s);
-  DiracState st = states[make_tuple(n, l, s)];
+  {
+    lock_guard<mutex> lock(*states_mutex);
+    st = states[make_tuple(n, l, s)];
+  }
 
   if (!st.converged) {
     throw runtime_error("State is not converged");
   }
 
+  if (correction_mode == PERTURBATIVE_CORRECTIONS && (use_uehling || use_econf)
+      && !(idshell > 0 && n >= idshell)) {
+    correctState(st, n);
+  }
+
   return DiracState(st);
 }
 
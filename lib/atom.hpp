@@ -13,6 +13,7 @@
 
 #include "../vendor/aixlog/aixlog.hpp"
 #include "boundary.hpp"
+#include "bspline.hpp"
 #include "constants.hpp"
 #include "econfigs.hpp"
 #include "elements.hpp"
@@ -21,9 +22,20 @@
 #include "potential.hpp"
 #include "state.hpp"
 #include "utils.hpp"
+#include "wavefunction.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -47,6 +59,21 @@ enum NuclearRadiusModel {
   FERMI2
 };
 
+enum EnergySearchMethod {
+  DAMPED_NEWTON, // Newton steps scaled by Edamp and limited by max_dE_ratio
+  SAFE_NEWTON    // Full Newton steps within a bracket, Illinois otherwise
+};
+
+enum DiracSolverMethod {
+  SHOOTING, // Shooting and matching, one state at a time
+  BSPLINE   // Diagonalisation in a dual kinetic balance B-spline basis
+};
+
+enum CorrectionMode {
+  FULL_CORRECTIONS,        // Uehling and electronic terms included in the potential
+  PERTURBATIVE_CORRECTIONS // Added to the energies to first order in perturbation theory
+};
+
 // Main classes
 class TransitionMatrix {
  public:
@@ -77,6 +104,7 @@ class Atom {
   // Tolerances and other details
   double Etol = 1e-7, Edamp = 0.5;
   double max_dE_ratio = 1e-1;
+  EnergySearchMethod Esearch = SAFE_NEWTON;
   double nodetol = 1e-6;
   int maxit_E = 100;
   int maxit_nodes = 100;
@@ -101,13 +129,41 @@ class Atom {
   double dx = 0.005; // Step 
   
   //Potential
-  CoulombSpherePotential *V_coulomb;
+  shared_ptr<CoulombSpherePotential> V_coulomb; // Shared by copies of the atom
+  double fermi2_T = Physical::fermi2_T;
 
   // Additional potential terms
   bool use_uehling = false;
   UehlingSpherePotential V_uehling;
+  int uehling_steps = 0;
+  double uehling_cut_low = 0, uehling_cut_high = INFINITY;
+  bool uehling_tabulated = false;
   bool use_econf = false;
   EConfPotential V_econf;
+  string econf_key = ""; // Description of the electronic background settings
+  CorrectionMode correction_mode = FULL_CORRECTIONS;
+
+  // Grid points rc*exp(i*dx), their logarithm and the total potential on
+  // them, tabulated for Vtable_i0 <= i <= Vtable_i1. The tables are never
+  // modified, only replaced with larger ones, so that states can share them
+  shared_ptr<const vector<double>> rtable, logrtable, Vtable;
+  int Vtable_i0 = 0, Vtable_i1 = -1;
+  shared_ptr<mutex> Vtable_mutex; // Guards the tables when solving in parallel
+  // Potential at the midpoints rc*exp((i+1/2)*dx), tabulated only on demand
+  // for Vmidtable_i0 <= i <= Vmidtable_i1
+  shared_ptr<const vector<double>> Vmidtable;
+  int Vmidtable_i0 = 0, Vmidtable_i1 = -1;
+  // Expansion of the potential inside the nucleus, fitted on demand up to
+  // Vseries_r1
+  vector<double> Vseries;
+  double Vseries_r1 = 0;
+  // Uehling and electronic background terms on the grid, tabulated only on
+  // demand for dVtable_i0 <= i <= dVtable_i1
+  shared_ptr<const vector<double>> dVtable;
+  int dVtable_i0 = 0, dVtable_i1 = -1;
+
+  void extendTables(int i0, int i1);
+  void clearVTable();
 
  public:
   Atom(int Z = 1, double m = 1, int A = -1,
@@ -135,6 +191,13 @@ class Atom {
   };
   double getV(double r);
   vector<double> getV(vector<double> r);
+  double getVCorrection(double r);
+  vector<double> getVgrid(int i0, int i1);
+  void getGridSlices(int i0, int i1, SharedSlice &r, SharedSlice &logr,
+                     SharedSlice &V);
+  SharedSlice getVmidSlice(int i0, int i1);
+  vector<double> getVSeries(double r1);
+  SharedSlice getVCorrectionSlice(int i0, int i1);
   double getrc() {
     return rc;
   };
@@ -148,7 +211,7 @@ class Atom {
   uint getPotentialFlags() {
     return HAS_UEHLING * use_uehling + HAS_ELECTRONIC * use_econf;
   };
-  CoulombSpherePotential *getPotentialCoulomb() {
+  shared_ptr<CoulombSpherePotential> getPotentialCoulomb() {
     return V_coulomb;
   };
   UehlingSpherePotential getPotentialUehling() {
@@ -160,20 +223,29 @@ class Atom {
 
   void setgrid(double rc, double dx);
 
+  // Nuclear size
+  void setRadius(double R, double rc = -1);
+
   // Additional potential terms get/setters
   void setFermi2(double thickness = Physical::fermi2_T);
   bool getUehling() {
     return use_uehling;
   };
   void setUehling(bool s, int usteps = 1000, double cut_low = 0,
-                  double cut_high = INFINITY);
+                  double cut_high = INFINITY, bool tabulated = false);
   // Electronic background
   void setElectBkgConfig(bool s, ElectronicConfiguration econf,
                          double rho_eps = 1e-5, double max_r0 = -1,
                          double min_r1 = -1);
+  CorrectionMode getCorrectionMode() {
+    return correction_mode;
+  };
+  void setCorrectionMode(CorrectionMode mode);
 
   // Clear computed states
-  virtual void reset() {};
+  virtual void reset(bool /* warm */ = false) {};
+  // Clear perturbative corrections to computed states
+  virtual void resetCorrections() {};
 };
 
 class DiracAtom : public Atom {
@@ -181,12 +253,51 @@ class DiracAtom : public Atom {
   double restE; // Rest energy
   // Eigenstates
   map<tuple<int, int, bool>, DiracState> states;
+  // States converged before the last change of potential or grid, used as
+  // warm starts by convergeState
+  map<tuple<int, int, bool>, DiracState> warm_states;
+  shared_ptr<mutex> states_mutex; // Guards states when solving in parallel
   int idshell = -1;
+  // On-disk cache of converged states
+  string cache_dir = "";
+  bool cache_loaded = false;
+  // Atoms with grid steps dx/2^level used by extrapolateState and
+  // refineState; created when first needed
+  map<int, shared_ptr<DiracAtom>> grid_atoms;
+  // Atom with grid step dx*multigrid_factor used by convergeState
+  shared_ptr<DiracAtom> coarse_atom;
+  // First order corrections to the energies of states and estimates of the
+  // second order ones, used with PERTURBATIVE_CORRECTIONS
+  map<tuple<int, int, bool>, pair<double, double>> corrections;
+
+  void loadStateCache();
+  shared_ptr<DiracAtom> gridCopy(double newdx);
+  shared_ptr<DiracAtom> gridAtom(int level);
+  shared_ptr<DiracAtom> coarseAtom();
+  double warmEnergy(int n, int k, double E);
+  double methodOrder();
+  void correctState(DiracState &state, int n);
+  // Accuracy required on the transition energies (0 for none)
+  double target_accuracy = 0;
 
  public:
   double out_eps = 1e-5;
   double in_eps = 1e-5;
   int min_n = 1000;
+  int nthreads = 1;    // Number of threads used by calcStates
+  int shoot_lanes = 1; // Number of energies tried per iteration in convergeNodes
+  bool pruefer_nodes = true; // Bracket the nodes with the Pruefer phase
+  bool parallel_legs = false; // Integrate forward and backwards on two threads
+  int shoot_segments = 1; // Segments integrated in parallel by multiple shooting
+  DiracIntegrator shoot_method = RK4_AVERAGED; // Method used to integrate states
+  double shoot_tol = 1e-11; // Local error tolerance for adaptive integration
+  int richardson_levels = 1; // Grids used to extrapolate the energies of states
+  int multigrid_factor = 1;  // Ratio of the coarse grid step used by convergeState
+  bool series_boundaries = false; // Start integrations from series at both ends
+  DiracSolverMethod solver = SHOOTING;
+  int bspline_size = 100; // Number of B-splines used by the BSPLINE solver
+  int bspline_order = 8;  // Order of the B-splines used by the BSPLINE solver
+  double perturbative_tol = 0.1 * Physical::eV; // Second order correction above which to warn (0 for no estimate)
 
   DiracAtom(int Z = 1, double m = 1, int A = -1,
             NuclearRadiusModel radius_model = POINT, double fc = 1.0,
@@ -196,22 +307,56 @@ class DiracAtom : public Atom {
     return restE;
   };
 
-  void reset() override;
+  void reset(bool warm = false) override;
+  void warmStart(DiracAtom &other);
+  void resetCorrections() override;
+
+  void setTargetAccuracy(double acc);
+  double getTargetAccuracy() {
+    return target_accuracy;
+  };
+
+  // State cache
+  void setStateCache(string dir);
+  string stateCacheKey();
+  string stateCacheFile();
+  void saveStateCache();
 
   void calcState(int n, int l, bool s, bool force = false);
+  void calcStates(vector<tuple<int, int, bool>> qnums, bool force = false);
+  void calcKappaSeries(int k, int max_n, bool force = false);
+  vector<DiracState> solveKappaBSpline(int k, int max_n);
   void calcAllStates(int max_n, bool force = false);
 
   // Convergence
   pair<double, double> energyLimits(int nodes = 0, int k = -1);
   pair<int, int> gridLimits(double E, int k);
   DiracState initState(double E, int k = -1);
-  void integrateState(DiracState &state, TurningPoint &tp);
-  void integrateState(DiracState &state, TurningPoint &tp, double &dE);
+  void integrateState(DiracState &state, TurningPoint &tp, bool zeta = false);
+  void integrateState(DiracState &state, TurningPoint &tp, double &dE,
+                      DiracWorkspace *ws = NULL);
+  double energyStep(DiracState &state, TurningPoint &tp,
+                    DiracWorkspace *ws = NULL);
+  void integrateStates(vector<DiracState> &states, vector<TurningPoint> &tps,
+                       DiracWorkspace *ws = NULL);
+  double phaseCount(double E, int k = -1);
   void convergeNodes(DiracState &state, TurningPoint &tp, int targ_nodes,
                      double &minE, double &maxE);
+  void convergeNodesLanes(DiracState &state, TurningPoint &tp, int targ_nodes,
+                          double &minE, double &maxE);
+  void convergeNodesPhase(DiracState &state, TurningPoint &tp, int targ_nodes,
+                          double &minE, double &maxE,
+                          map<double, double> *phases = NULL);
   void convergeE(DiracState &state, TurningPoint &tp, double &minE,
-                 double &maxE);
-  DiracState convergeState(int n = 1, int k = -1);
+                 double &maxE, bool integrated = false);
+  void convergeEDamped(DiracState &state, TurningPoint &tp, double &minE,
+                       double &maxE);
+  void convergeESafe(DiracState &state, TurningPoint &tp, double &minE,
+                     double &maxE, bool integrated = false);
+  DiracState convergeState(int n = 1, int k = -1,
+                           map<double, double> *phases = NULL);
+  void extrapolateState(DiracState &state, int n);
+  void refineState(DiracState &state, int n);
   DiracState getState(int n, int l, bool s);
   TransitionMatrix getTransitionProbabilities(int n1, int l1, bool s1, int n2,
       int l2, bool s2, bool approx_j0 = false);
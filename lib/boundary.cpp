@@ -116,12 +116,7 @@ void boundaryDiracCoulomb(DiracState &state, double m, double Z, double R) {
  * @retval None
  */
 void boundaryDiracErrorDECoulomb(vector<double> &zeta, double E, int k, double m) {
-  int l; // Angular momentum number
-  bool s;
   int N = zeta.size();
-  double K, gp;
-
-  qnumDirac2Schro(k, l, s);
 
   if (N < 4) {
     throw "Invalid array size passed to boundaryDiracErrorDECoulomb";
@@ -129,6 +124,22 @@ void boundaryDiracErrorDECoulomb(vector<double> &zeta, double E, int k, double m
 
   // In the r=0 limit, it's fine to have it be 0
   zeta[0] = 0;
+  zeta[N - 1] = boundaryDiracErrorDECoulomb(E, k, m);
+}
+
+/**
+ * @brief  Compute the boundary condition of d/dE (Q/P) at infinity for a Dirac wavefunction based on a Coulomb
+ * potential
+ * @note   Compute the value of zeta = d/dE (Q/P) in the r => inf limit, as set by the version of this function
+ * acting on a vector, for use with shootDiracLog when it integrates zeta along with Q and P.
+ *
+ * @param  E:  Energy (binding + mc^2)
+ * @param  k:  Quantum number (default = -1, unused: the limit does not depend on it)
+ * @param  m:  Mass of the particle (default = 1)
+ * @retval     Value of zeta at infinity
+ */
+double boundaryDiracErrorDECoulomb(double E, int /* k */, double m) {
+  double K, gp;
 
   // r = inf limit
   K = pow(m * Physical::c, 2) - pow(E * Physical::alpha, 2);
@@ -137,5 +148,167 @@ void boundaryDiracErrorDECoulomb(vector<double> &zeta, double E, int k, double m
     throw "Can't compute boundary conditions for non-bound state";
   }
   K = sqrt(K);
-  zeta[N - 1] = E / (K * gp) * pow(Physical::alpha, 2) + K / pow(gp, 2) * Physical::alpha;
-}
\ No newline at end of file
+  return E / (K * gp) * pow(Physical::alpha, 2) + K / pow(gp, 2) * Physical::alpha;
+}
+
+/**
+ * @brief  Impose series boundary conditions near the origin to a Dirac wavefunction
+ * @note   Set the Q and P components of a Dirac radial wavefunction at its first points, up to index i1, to the
+ * Frobenius series of the solution regular at the origin, so that the integration only needs to start from i1.
+ * For a point-like nucleus the potential is taken to be -Z/r + V0, and the series are
+ *
+ *      P = r^gamma sum_n p_n r^n,      Q = r^gamma sum_n q_n r^n
+ *
+ * with gamma = sqrt(k^2-(alpha*Z)^2). For a finite nucleus the potential is expanded in even powers of r, and the
+ * series start from r^|k|, with the leading term of Q (for k < 0) or P (for k > 0) vanishing. The coefficients
+ * follow from the Dirac equations order by order; terms are added until they no longer change the sums at the
+ * outermost point.
+ *
+ * @param  &state: Dirac State to apply the boundary conditions to
+ * @param  i1:     Last index to set
+ * @param  m:      Mass of the particle
+ * @param  Z:      Nuclear charge
+ * @param  R:      Nuclear radius; considered point-like if <= 0
+ * @param  Vc:     Coefficients of the potential: {V0} for a point-like nucleus, or those of r^0, r^2, r^4... for a
+ *                 finite one
+ * @retval None
+ */
+void boundaryDiracSeries(DiracState &state, int i1, double m, double Z, double R, vector<double> Vc) {
+  const int max_terms = 200;
+  int k = state.k;
+  double B = state.E - m * pow(Physical::c, 2);
+  double a = Physical::alpha, mc2 = 2 * m * Physical::c;
+  double s;
+  vector<double> p, q;
+
+  if (i1 < 0 || i1 >= state.size()) {
+    throw invalid_argument("Invalid index passed to boundaryDiracSeries");
+  }
+  if (Vc.size() == 0) {
+    Vc.push_back(0);
+  }
+
+  // Sums of the series at the outermost point, used to decide when to stop
+  double rmax = state.grid[i1];
+  double rn = 1, Psum = 0, Qsum = 0;
+  int small_terms = 0;
+  auto addTerms = [&](double pn, double qn) {
+    p.push_back(pn);
+    q.push_back(qn);
+    double tP = pn * rn, tQ = qn * rn;
+    Psum += tP;
+    Qsum += tQ;
+    rn *= rmax;
+    // Odd and even terms can vanish alternately, so look at two in a row
+    if (abs(tP) <= 1e-17 * abs(Psum) && abs(tQ) <= 1e-17 * abs(Qsum)) {
+      small_terms++;
+    } else {
+      small_terms = 0;
+    }
+  };
+
+  if (R <= 0) {
+    s = k * k - pow(a * Z, 2.0);
+    if (s < 0) {
+      throw invalid_argument("Can't compute boundary conditions for state with point-like nucleus and negative gamma");
+    }
+    s = sqrt(s);
+    double b = B - Vc[0];
+    addTerms(1, -a * Z / (s - k));
+    for (int n = 1; n < max_terms && small_terms < 2; ++n) {
+      // Both components of order n are coupled by the Coulomb term
+      double r1 = -a * b * p[n - 1];
+      double r2 = (a * b + mc2) * q[n - 1];
+      double det = n * (n + 2 * s);
+      addTerms((r2 * (n + s - k) + a * Z * r1) / det, (r1 * (n + s + k) - a * Z * r2) / det);
+    }
+  } else {
+    s = abs(k);
+    vector<double> w(Vc.size());
+    w[0] = B - Vc[0];
+    for (int j = 1; j < (int)Vc.size(); ++j) {
+      w[j] = -Vc[j];
+    }
+    addTerms(k < 0 ? 1 : 0, k < 0 ? 0 : 1);
+    for (int n = 1; n < max_terms && small_terms < 2; ++n) {
+      double sumP = 0, sumQ = 0;
+      for (int j = 0; j < (int)w.size() && n - 1 - 2 * j >= 0; ++j) {
+        sumP += w[j] * p[n - 1 - 2 * j];
+        sumQ += w[j] * q[n - 1 - 2 * j];
+      }
+      addTerms((a * sumQ + mc2 * q[n - 1]) / (n + s + k), -a * sumP / (n + s - k));
+    }
+  }
+
+  if (small_terms < 2) {
+    LOG(WARNING) << "Series boundary conditions did not converge up to r = " << rmax << "\n";
+  }
+  LOG(TRACE) << "Series boundary conditions up to r = " << rmax << " with " << p.size() << " terms\n";
+
+  // Closer to the origin fewer terms are needed; drop the ones that have become negligible
+  int nt = p.size();
+  double t0 = abs(p[0]) + abs(q[0]);
+  for (int i = i1; i >= 0; --i) {
+    double r = state.grid[i];
+    double Ps = 0, Qs = 0;
+    while (nt > 1 && (abs(p[nt - 1]) + abs(q[nt - 1])) * pow(r, nt - 1) <= 1e-17 * t0) {
+      nt--;
+    }
+    for (int n = nt - 1; n >= 0; --n) {
+      Ps = Ps * r + p[n];
+      Qs = Qs * r + q[n];
+    }
+    double rs = pow(r, s);
+    state.P[i] = rs * Ps;
+    state.Q[i] = rs * Qs;
+  }
+}
+
+/**
+ * @brief  Impose asymptotic boundary conditions to a Dirac wavefunction
+ * @note   Impose boundary conditions to the Q and P components of a Dirac radial wavefunction at its last point,
+ * from the asymptotic expansion of the solution in a Coulomb potential V = V_inf - Z_eff/r,
+ *
+ *      P = exp(-K r) r^nu (1 + O(1/r^2)),      Q = exp(-K r) r^nu (c0 + c1/r + O(1/r^2))
+ *
+ * with nu = Z_eff alpha^2 E/K, which corrects the ratio Q/P of boundaryDiracCoulomb to first order in 1/r. V_inf
+ * and Z_eff are fitted to the potential of the state at its last two points, so that screening by electrons is
+ * accounted for. Where exp(-K r) would underflow, P is set to the smallest normal double instead, so unlike
+ * boundaryDiracCoulomb the grid never needs to be shortened.
+ *
+ * @param  &state: Dirac State to apply the boundary conditions to
+ * @param  m:      Mass of the particle (default = 1)
+ * @retval None
+ */
+void boundaryDiracAsymptotic(DiracState &state, double m) {
+  int N = state.size();
+  int k = state.k;
+  double a = Physical::alpha;
+
+  if (N < 4) {
+    throw invalid_argument("Invalid state size passed to boundaryDiracAsymptotic");
+  }
+
+  double r1 = state.grid[N - 2], r2 = state.grid[N - 1];
+  double Zeff = (state.V[N - 1] - state.V[N - 2]) / (1.0 / r1 - 1.0 / r2);
+  double Vinf = state.V[N - 1] + Zeff / r2;
+  double E = state.E - Vinf;
+  double B = E - m * pow(Physical::c, 2);
+
+  double K = pow(m * Physical::c, 2) - pow(E * a, 2);
+  if (K < 0) {
+    throw invalid_argument("Can't compute boundary conditions for non-bound state");
+  }
+  K = sqrt(K);
+
+  double c0 = a * B / K;
+  double nu = Zeff * a * a * E / K;
+  double c1 = (nu - a * Zeff * c0 + k) / (a * B + 2 * m * Physical::c);
+
+  double logP = max(-K * r2 + nu * log(r2), log(numeric_limits<double>::min()));
+  state.P[N - 1] = exp(logP);
+  state.Q[N - 1] = (c0 + c1 / r2) * state.P[N - 1];
+
+  LOG(TRACE) << "Asymptotic boundary conditions at r => inf (" << r2 << "), Z_eff = " << Zeff << ", nu = " << nu
+             << ", Q/P = " << state.Q[N - 1] / state.P[N - 1] << "\n";
+}
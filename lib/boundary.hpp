@@ -10,6 +10,7 @@
  * @version 1.0 20/03/2020
  */
 
+#include <limits>
 #include <math.h>
 #include <vector>
 #include "constants.hpp"
@@ -23,6 +24,9 @@ using namespace std;
 #define MUDIRAC_BOUNDARY
 
 void boundaryDiracCoulomb(DiracState &state, double m = 1, double Z = 1, double R = -1);
+void boundaryDiracSeries(DiracState &state, int i1, double m, double Z, double R, vector<double> Vc = {});
+void boundaryDiracAsymptotic(DiracState &state, double m = 1);
 void boundaryDiracErrorDECoulomb(vector<double> &zeta, double E, int k = -1, double m = 1);
+double boundaryDiracErrorDECoulomb(double E, int k = -1, double m = 1);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,690 @@
+/**
+ * MuDirac - A muonic atom Dirac equation solver
+ * by Simone Sturniolo (2019-2020)
+ *
+ * bspline.cpp
+ *
+ * B-spline basis sets and the linear algebra needed to solve the radial Dirac
+ * equation by diagonalisation
+ *
+ * @author Simone Sturniolo
+ * @version 1.0 20/03/2020
+ */
+
+#include "bspline.hpp"
+
+/**
+ * @brief  Create a B-spline basis
+ * @note   Create a basis of B-splines of given order on a knot sequence.
+ * The sequence must be non-decreasing, and to have splines that go to zero
+ * smoothly only at the internal knots, the first and last knot should be
+ * repeated order times.
+ *
+ * @param  t:       Knot sequence
+ * @param  order:   Order of the splines (degree + 1, default = 8)
+ * @retval None
+ */
+BSplineBasis::BSplineBasis(vector<double> t, int order) {
+  if (order < 1) {
+    throw invalid_argument("Invalid order for BSplineBasis");
+  }
+  if ((int)t.size() < 2 * order) {
+    throw invalid_argument("Not enough knots for BSplineBasis");
+  }
+  for (int i = 1; i < (int)t.size(); ++i) {
+    if (t[i] < t[i - 1]) {
+      throw invalid_argument("Knot sequence for BSplineBasis is not sorted");
+    }
+  }
+
+  this->t = t;
+  this->order = order;
+}
+
+/**
+ * @brief  Find the knot interval containing a point
+ * @note   Find the index i such that t_i <= x < t_i+1, restricted to the
+ * intervals in which a full set of order splines is defined. Points at the
+ * upper end of the knot sequence belong to the last non-empty interval.
+ *
+ * @param  x:   Point
+ * @retval      Index of the interval
+ */
+int BSplineBasis::findInterval(double x) {
+  int N = size();
+
+  if (x < t[order - 1] || x > t[N]) {
+    throw invalid_argument("Point out of range for BSplineBasis");
+  }
+  if (x == t[N]) {
+    int i = N - 1;
+    while (t[i] == t[i + 1]) {
+      --i;
+    }
+    return i;
+  }
+
+  return upper_bound(t.begin() + order - 1, t.begin() + N + 1, x) - t.begin() -
+         1;
+}
+
+/**
+ * @brief  Evaluate the non-zero splines and their derivatives at a point
+ * @note   Evaluate the order splines that are non-zero at x, together with
+ * their derivatives up to nder, using the recursion by Cox and de Boor (as
+ * formulated in Piegl & Tiller, The NURBS Book, algorithm A2.3).
+ *
+ * @param  x:       Point
+ * @param  &ders:   Will contain the values, with ders[d][j] the d-th
+ * derivative of spline i0+j
+ * @param  nder:    Highest derivative to compute (default = 0)
+ * @retval          Index i0 of the first non-zero spline
+ */
+int BSplineBasis::evaluate(double x, vector<vector<double>> &ders, int nder) {
+  int p = order - 1;
+  int i = findInterval(x);
+  vector<double> left(order), right(order);
+  vector<vector<double>> ndu(order, vector<double>(order));
+  vector<vector<double>> a(2, vector<double>(order));
+
+  nder = min(nder, p);
+  ders = vector<vector<double>>(nder + 1, vector<double>(order, 0.0));
+
+  ndu[0][0] = 1.0;
+  for (int j = 1; j <= p; ++j) {
+    double saved = 0.0;
+    left[j] = x - t[i + 1 - j];
+    right[j] = t[i + j] - x;
+    for (int r = 0; r < j; ++r) {
+      ndu[j][r] = right[r + 1] + left[j - r];
+      double tmp = ndu[r][j - 1] / ndu[j][r];
+      ndu[r][j] = saved + right[r + 1] * tmp;
+      saved = left[j - r] * tmp;
+    }
+    ndu[j][j] = saved;
+  }
+
+  for (int j = 0; j <= p; ++j) {
+    ders[0][j] = ndu[j][p];
+  }
+
+  for (int r = 0; r <= p; ++r) {
+    int s1 = 0, s2 = 1;
+    a[0][0] = 1.0;
+    for (int k = 1; k <= nder; ++k) {
+      double d = 0.0;
+      int rk = r - k, pk = p - k;
+      if (r >= k) {
+        a[s2][0] = a[s1][0] / ndu[pk + 1][rk];
+        d = a[s2][0] * ndu[rk][pk];
+      }
+      int j1 = (rk >= -1) ? 1 : -rk;
+      int j2 = (r - 1 <= pk) ? k - 1 : p - r;
+      for (int j = j1; j <= j2; ++j) {
+        a[s2][j] = (a[s1][j] - a[s1][j - 1]) / ndu[pk + 1][rk + j];
+        d += a[s2][j] * ndu[rk + j][pk];
+      }
+      if (r <= pk) {
+        a[s2][k] = -a[s1][k - 1] / ndu[pk + 1][r];
+        d += a[s2][k] * ndu[r][pk];
+      }
+      ders[k][r] = d;
+      swap(s1, s2);
+    }
+  }
+
+  double f = p;
+  for (int k = 1; k <= nder; ++k) {
+    for (int j = 0; j <= p; ++j) {
+      ders[k][j] *= f;
+    }
+    f *= (p - k);
+  }
+
+  return i - p;
+}
+
+/**
+ * @brief  Gaussian quadrature points over the whole basis
+ * @note   Return the points and weights of a Gauss-Legendre quadrature
+ * with nq points in each non-empty knot interval.
+ *
+ * @param  nq:  Number of points per interval
+ * @param  &x:  Quadrature points
+ * @param  &w:  Quadrature weights
+ * @retval None
+ */
+void BSplineBasis::quadrature(int nq, vector<double> &x, vector<double> &w) {
+  vector<double> xgl, wgl;
+
+  gaussLegendre(nq, xgl, wgl);
+  x.clear();
+  w.clear();
+
+  for (int i = order - 1; i < size(); ++i) {
+    double h = (t[i + 1] - t[i]) / 2.0;
+    if (h <= 0)
+      continue;
+    for (int j = 0; j < nq; ++j) {
+      x.push_back(t[i] + h * (xgl[j] + 1));
+      w.push_back(h * wgl[j]);
+    }
+  }
+}
+
+/**
+ * @brief  Points and weights for Gauss-Legendre quadrature
+ * @note   Compute the points and weights for an n-point Gauss-Legendre
+ * quadrature on the interval [-1, 1], by Newton's method on the roots of the
+ * Legendre polynomial P_n.
+ *
+ * @param  n:   Number of points
+ * @param  &x:  Quadrature points
+ * @param  &w:  Quadrature weights
+ * @retval None
+ */
+void gaussLegendre(int n, vector<double> &x, vector<double> &w) {
+  x = vector<double>(n);
+  w = vector<double>(n);
+
+  for (int i = 0; i < (n + 1) / 2; ++i) {
+    double z = cos(M_PI * (i + 0.75) / (n + 0.5));
+    double dp;
+    for (int it = 0; it < 100; ++it) {
+      double p0 = 1.0, p1 = 0.0;
+      for (int j = 1; j <= n; ++j) {
+        double p2 = p1;
+        p1 = p0;
+        p0 = ((2 * j - 1) * z * p1 - (j - 1) * p2) / j;
+      }
+      dp = n * (z * p0 - p1) / (z * z - 1);
+      double dz = p0 / dp;
+      z -= dz;
+      if (abs(dz) < 1e-15)
+        break;
+    }
+    x[i] = -z;
+    x[n - 1 - i] = z;
+    w[i] = w[n - 1 - i] = 2 / ((1 - z * z) * dp * dp);
+  }
+}
+
+/**
+ * @brief  Index of a function in the dual kinetic balance basis
+ * @note   Index of the basis function of type t (0 = large component,
+ * 1 = small component) built on spline s, or -1 if it is left out (see
+ * dkbDiracMatrices).
+ *
+ * @param  s:   Index of the spline
+ * @param  t:   Type of the function
+ * @param  k:   Quantum number k
+ * @retval      Index of the function, or -1
+ */
+static int dkbIndex(int s, int t, int k) {
+  int n1 = (abs(k) == 1) ? 1 : 0;
+
+  if (s == 1) {
+    return ((t == 0 && k == -1) || (t == 1 && k == 1)) ? 0 : -1;
+  }
+
+  return n1 + 2 * (s - 2) + t;
+}
+
+/**
+ * @brief  Matrices of the radial Dirac Hamiltonian in a dual kinetic balance
+ * B-spline basis
+ * @note   Build the Hamiltonian and overlap matrices for the radial Dirac
+ * equation (in terms of binding energy, see shootDiracLog)
+ *
+ *      | V                  c(-d/dr + k/r) | |P|     |P|
+ *      | c(d/dr + k/r)      V - 2mc^2      | |Q| = B |Q|
+ *
+ * in the dual kinetic balance basis of Shabaev et al., Phys. Rev. Lett. 93,
+ * 130405 (2004). For each spline B_i there are two basis functions,
+ *
+ *      (B_i, (d/dr + k/r) B_i / 2mc)   and   ((d/dr - k/r) B_i / 2mc, B_i)
+ *
+ * which are stored interleaved, so that both matrices are banded with
+ * half-bandwidth 2*order-1. The first and last spline are left out, so that
+ * P and Q vanish at both ends. The second spline goes linearly to zero at the
+ * origin, so of the two functions built on it only the one for which both P
+ * and Q vanish there is kept, and only if |k| = 1; the others would not
+ * behave like a regular solution, and make the k/r terms diverge. The
+ * matrices are returned in lower band storage, with A[i][d] the element
+ * (i, i-d).
+ *
+ * @param  &basis:  B-spline basis
+ * @param  rq:      Quadrature points (see BSplineBasis::quadrature)
+ * @param  wq:      Quadrature weights
+ * @param  Vq:      Potential at the quadrature points
+ * @param  k:       Quantum number k
+ * @param  m:       Mass of the particle
+ * @param  &H:      Hamiltonian matrix
+ * @param  &S:      Overlap matrix
+ * @retval None
+ */
+void dkbDiracMatrices(BSplineBasis &basis, vector<double> rq, vector<double> wq,
+                      vector<double> Vq, int k, double m,
+                      vector<vector<double>> &H, vector<vector<double>> &S) {
+  int ns = basis.size() - 2;
+  int order = basis.getOrder();
+  int bw = 2 * order - 1;
+  int nb = dkbIndex(ns, 1, k) + 1;
+  double c = Physical::c, mc2 = 2 * m * Physical::c;
+  vector<vector<double>> ders;
+
+  if (ns < 2 || order < 3) {
+    throw invalid_argument("Basis too small for dkbDiracMatrices");
+  }
+  if (rq.size() != wq.size() || rq.size() != Vq.size()) {
+    throw invalid_argument("Invalid size for one or more arrays passed to dkbDiracMatrices");
+  }
+
+  H = vector<vector<double>>(nb, vector<double>(bw + 1, 0.0));
+  S = vector<vector<double>>(nb, vector<double>(bw + 1, 0.0));
+
+  for (int q = 0; q < (int)rq.size(); ++q) {
+    double r = rq[q];
+    int i0 = basis.evaluate(r, ders, 2);
+    vector<int> a;
+    vector<double> P, dP, Q, dQ;
+
+    if (r <= 0)
+      continue;
+
+    for (int j = 0; j < order; ++j) {
+      int s = i0 + j;
+      double B = ders[0][j], dB = ders[1][j], d2B = ders[2][j];
+      if (s < 1 || s > ns)
+        continue;
+      // Large component type
+      if (dkbIndex(s, 0, k) >= 0) {
+        a.push_back(dkbIndex(s, 0, k));
+        P.push_back(B);
+        dP.push_back(dB);
+        Q.push_back((dB + k * B / r) / mc2);
+        dQ.push_back((d2B + k * dB / r - k * B / (r * r)) / mc2);
+      }
+      // Small component type
+      if (dkbIndex(s, 1, k) >= 0) {
+        a.push_back(dkbIndex(s, 1, k));
+        P.push_back((dB - k * B / r) / mc2);
+        dP.push_back((d2B - k * dB / r + k * B / (r * r)) / mc2);
+        Q.push_back(B);
+        dQ.push_back(dB);
+      }
+    }
+
+    for (int i = 0; i < (int)a.size(); ++i) {
+      for (int j = 0; j < (int)a.size(); ++j) {
+        if (a[j] > a[i])
+          continue;
+        double PP = P[i] * P[j], QQ = Q[i] * Q[j];
+        // Symmetrised, as the two orderings differ by boundary terms
+        double hij = P[i] * (-dQ[j] + k * Q[j] / r) + Q[i] * (dP[j] + k * P[j] / r);
+        double hji = P[j] * (-dQ[i] + k * Q[i] / r) + Q[j] * (dP[i] + k * P[i] / r);
+        H[a[i]][a[i] - a[j]] += wq[q] * (Vq[q] * (PP + QQ) -
+                                         m * c * c * 2 * QQ + c * (hij + hji) / 2);
+        S[a[i]][a[i] - a[j]] += wq[q] * (PP + QQ);
+      }
+    }
+  }
+}
+
+/**
+ * @brief  Wavefunction from its coefficients in a dual kinetic balance basis
+ * @note   Compute P and Q on a grid from the coefficients of a solution found
+ * in the basis used by dkbDiracMatrices. Both are zero outside of the range
+ * of the basis.
+ *
+ * @param  &basis:  B-spline basis
+ * @param  c:       Coefficients
+ * @param  k:       Quantum number k
+ * @param  m:       Mass of the particle
+ * @param  r:       Grid
+ * @param  &P:      Large component
+ * @param  &Q:      Small component
+ * @retval None
+ */
+void dkbDiracWavefunction(BSplineBasis &basis, vector<double> c, int k,
+                          double m, vector<double> r, vector<double> &P,
+                          vector<double> &Q) {
+  int ns = basis.size() - 2;
+  int order = basis.getOrder();
+  double mc2 = 2 * m * Physical::c;
+  vector<double> t = basis.getKnots();
+  vector<vector<double>> ders;
+
+  if ((int)c.size() != dkbIndex(ns, 1, k) + 1) {
+    throw invalid_argument("Invalid size for coefficients passed to dkbDiracWavefunction");
+  }
+
+  P = vector<double>(r.size(), 0.0);
+  Q = vector<double>(r.size(), 0.0);
+
+  for (int i = 0; i < (int)r.size(); ++i) {
+    if (r[i] <= t[0] || r[i] >= t[t.size() - 1])
+      continue;
+    int i0 = basis.evaluate(r[i], ders, 1);
+    for (int j = 0; j < order; ++j) {
+      int s = i0 + j;
+      double B = ders[0][j], dB = ders[1][j];
+      if (s < 1 || s > ns)
+        continue;
+      int iL = dkbIndex(s, 0, k), iS = dkbIndex(s, 1, k);
+      double cL = (iL >= 0) ? c[iL] : 0, cS = (iS >= 0) ? c[iS] : 0;
+      P[i] += cL * B + cS * (dB - k * B / r[i]) / mc2;
+      Q[i] += cL * (dB + k * B / r[i]) / mc2 + cS * B;
+    }
+  }
+}
+
+/**
+ * @brief  Cholesky factorisation of a banded matrix
+ * @note   Replace a symmetric positive definite matrix, in lower band storage
+ * (A[i][d] is the element (i, i-d)), with its Cholesky factor L, such that
+ * A = L*L^T, in the same storage.
+ *
+ * @param  &A:  Matrix to factorise
+ * @retval None
+ */
+void bandCholesky(vector<vector<double>> &A) {
+  int n = A.size();
+  int bw = A[0].size() - 1;
+
+  for (int j = 0; j < n; ++j) {
+    double d = A[j][0];
+    for (int p = max(0, j - bw); p < j; ++p) {
+      d -= A[j][j - p] * A[j][j - p];
+    }
+    if (d <= 0) {
+      throw runtime_error("Matrix is not positive definite in bandCholesky");
+    }
+    A[j][0] = sqrt(d);
+    for (int i = j + 1; i <= min(n - 1, j + bw); ++i) {
+      double s = A[i][i - j];
+      for (int p = max(0, i - bw); p < j; ++p) {
+        s -= A[i][i - p] * A[j][j - p];
+      }
+      A[i][i - j] = s / A[j][0];
+    }
+  }
+}
+
+/**
+ * @brief  Eigenvalues and eigenvectors of a symmetric matrix
+ * @note   Diagonalise a dense symmetric matrix by Householder reduction to
+ * tridiagonal form followed by the implicit QL algorithm (after the EISPACK
+ * routines tred2 and tql2). On exit A contains the eigenvectors as columns,
+ * and the eigenvalues are sorted in increasing order.
+ *
+ * @param  &A:      Matrix to diagonalise; replaced by the eigenvectors
+ * @param  &evals:  Eigenvalues
+ * @retval None
+ */
+void symmetricEigen(vector<vector<double>> &A, vector<double> &evals) {
+  int n = A.size();
+  vector<double> &d = evals;
+  vector<double> e(n, 0.0);
+  vector<vector<double>> &V = A;
+
+  d = vector<double>(n);
+  for (int j = 0; j < n; ++j) {
+    d[j] = V[n - 1][j];
+  }
+
+  // Householder reduction to tridiagonal form
+  for (int i = n - 1; i > 0; --i) {
+    double scale = 0.0, h = 0.0;
+    for (int k = 0; k < i; ++k) {
+      scale += abs(d[k]);
+    }
+    if (scale == 0.0) {
+      e[i] = d[i - 1];
+      for (int j = 0; j < i; ++j) {
+        d[j] = V[i - 1][j];
+        V[i][j] = 0.0;
+        V[j][i] = 0.0;
+      }
+    } else {
+      for (int k = 0; k < i; ++k) {
+        d[k] /= scale;
+        h += d[k] * d[k];
+      }
+      double f = d[i - 1];
+      double g = sqrt(h);
+      if (f > 0) {
+        g = -g;
+      }
+      e[i] = scale * g;
+      h -= f * g;
+      d[i - 1] = f - g;
+      for (int j = 0; j < i; ++j) {
+        e[j] = 0.0;
+      }
+      for (int j = 0; j < i; ++j) {
+        f = d[j];
+        V[j][i] = f;
+        g = e[j] + V[j][j] * f;
+        for (int k = j + 1; k <= i - 1; ++k) {
+          g += V[k][j] * d[k];
+          e[k] += V[k][j] * f;
+        }
+        e[j] = g;
+      }
+      f = 0.0;
+      for (int j = 0; j < i; ++j) {
+        e[j] /= h;
+        f += e[j] * d[j];
+      }
+      double hh = f / (h + h);
+      for (int j = 0; j < i; ++j) {
+        e[j] -= hh * d[j];
+      }
+      for (int j = 0; j < i; ++j) {
+        f = d[j];
+        g = e[j];
+        for (int k = j; k <= i - 1; ++k) {
+          V[k][j] -= (f * e[k] + g * d[k]);
+        }
+        d[j] = V[i - 1][j];
+        V[i][j] = 0.0;
+      }
+    }
+    d[i] = h;
+  }
+
+  // Accumulate transformations
+  for (int i = 0; i < n - 1; ++i) {
+    V[n - 1][i] = V[i][i];
+    V[i][i] = 1.0;
+    double h = d[i + 1];
+    if (h != 0.0) {
+      for (int k = 0; k <= i; ++k) {
+        d[k] = V[k][i + 1] / h;
+      }
+      for (int j = 0; j <= i; ++j) {
+        double g = 0.0;
+        for (int k = 0; k <= i; ++k) {
+          g += V[k][i + 1] * V[k][j];
+        }
+        for (int k = 0; k <= i; ++k) {
+          V[k][j] -= g * d[k];
+        }
+      }
+    }
+    for (int k = 0; k <= i; ++k) {
+      V[k][i + 1] = 0.0;
+    }
+  }
+  for (int j = 0; j < n; ++j) {
+    d[j] = V[n - 1][j];
+    V[n - 1][j] = 0.0;
+  }
+  V[n - 1][n - 1] = 1.0;
+  e[0] = 0.0;
+
+  // Implicit QL on the tridiagonal matrix
+  for (int i = 1; i < n; ++i) {
+    e[i - 1] = e[i];
+  }
+  e[n - 1] = 0.0;
+
+  double f = 0.0, tst1 = 0.0;
+  double eps = pow(2.0, -52.0);
+  for (int l = 0; l < n; ++l) {
+    tst1 = max(tst1, abs(d[l]) + abs(e[l]));
+    int m = l;
+    while (m < n - 1 && abs(e[m]) > eps * tst1) {
+      ++m;
+    }
+    if (m > l) {
+      int it = 0;
+      do {
+        if (++it > 30 * n) {
+          throw runtime_error("symmetricEigen failed to converge");
+        }
+        double g = d[l];
+        double p = (d[l + 1] - g) / (2.0 * e[l]);
+        double r = hypot(p, 1.0);
+        if (p < 0) {
+          r = -r;
+        }
+        d[l] = e[l] / (p + r);
+        d[l + 1] = e[l] * (p + r);
+        double dl1 = d[l + 1];
+        double h = g - d[l];
+        for (int i = l + 2; i < n; ++i) {
+          d[i] -= h;
+        }
+        f += h;
+
+        p = d[m];
+        double c = 1.0, c2 = c, c3 = c;
+        double el1 = e[l + 1];
+        double s = 0.0, s2 = 0.0;
+        for (int i = m - 1; i >= l; --i) {
+          c3 = c2;
+          c2 = c;
+          s2 = s;
+          g = c * e[i];
+          h = c * p;
+          r = hypot(p, e[i]);
+          e[i + 1] = s * r;
+          s = e[i] / r;
+          c = p / r;
+          p = c * d[i] - s * g;
+          d[i + 1] = h + s * (c * g + s * d[i]);
+          for (int k = 0; k < n; ++k) {
+            h = V[k][i + 1];
+            V[k][i + 1] = s * V[k][i] + c * h;
+            V[k][i] = c * V[k][i] - s * h;
+          }
+        }
+        p = -s * s2 * c3 * el1 * e[l] / dl1;
+        e[l] = s * p;
+        d[l] = c * p;
+      } while (abs(e[l]) > eps * tst1);
+    }
+    d[l] += f;
+    e[l] = 0.0;
+  }
+
+  // Sort eigenvalues and vectors
+  for (int i = 0; i < n - 1; ++i) {
+    int k = i;
+    double p = d[i];
+    for (int j = i + 1; j < n; ++j) {
+      if (d[j] < p) {
+        k = j;
+        p = d[j];
+      }
+    }
+    if (k != i) {
+      d[k] = d[i];
+      d[i] = p;
+      for (int j = 0; j < n; ++j) {
+        swap(V[j][i], V[j][k]);
+      }
+    }
+  }
+}
+
+/**
+ * @brief  Solve a banded generalised symmetric eigenvalue problem
+ * @note   Solve H*c = E*S*c for symmetric banded H and symmetric positive
+ * definite banded S, both in lower band storage (see bandCholesky). S is
+ * factorised as L*L^T, exploiting the band structure in all the triangular
+ * solves, and the equivalent standard problem for L^-1*H*L^-T is solved with
+ * symmetricEigen. The eigenvectors are normalised so that c^T*S*c = 1.
+ *
+ * @param  H:       Hamiltonian matrix
+ * @param  S:       Overlap matrix
+ * @param  &evals:  Eigenvalues, in increasing order
+ * @param  &evecs:  Eigenvectors, evecs[j] being the one for evals[j]
+ * @retval None
+ */
+void generalizedBandEigen(vector<vector<double>> H, vector<vector<double>> S,
+                          vector<double> &evals,
+                          vector<vector<double>> &evecs) {
+  int n = H.size();
+  int bw = H[0].size() - 1;
+  vector<vector<double>> &L = S;
+  vector<vector<double>> C(n, vector<double>(n, 0.0));
+
+  if ((int)S.size() != n || (int)S[0].size() != bw + 1) {
+    throw invalid_argument("Invalid size for matrices passed to generalizedBandEigen");
+  }
+
+  bandCholesky(L);
+
+  // Forward substitution with L on each column of M
+  auto solveL = [&](vector<double> &x) {
+    for (int i = 0; i < n; ++i) {
+      double s = x[i];
+      for (int d = 1; d <= min(bw, i); ++d) {
+        s -= L[i][d] * x[i - d];
+      }
+      x[i] = s / L[i][0];
+    }
+  };
+
+  // X = L^-1*H, stored by rows of X^T
+  vector<vector<double>> X(n, vector<double>(n, 0.0));
+  for (int j = 0; j < n; ++j) {
+    for (int d = 0; d <= bw; ++d) {
+      if (j + d < n)
+        X[j][j + d] = H[j + d][d];
+      if (j - d >= 0)
+        X[j][j - d] = H[j][d];
+    }
+    solveL(X[j]);
+  }
+  // C = L^-1*X^T; since C is symmetric, row j of C is L^-1 times row j of X
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < n; ++i) {
+      C[j][i] = X[i][j];
+    }
+    solveL(C[j]);
+  }
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < i; ++j) {
+      C[i][j] = C[j][i] = (C[i][j] + C[j][i]) / 2.0;
+    }
+  }
+
+  symmetricEigen(C, evals);
+
+  // Back substitution with L^T
+  evecs = vector<vector<double>>(n, vector<double>(n));
+  for (int j = 0; j < n; ++j) {
+    vector<double> &c = evecs[j];
+    for (int i = n - 1; i >= 0; --i) {
+      double s = C[i][j];
+      for (int d = 1; d <= bw && i + d < n; ++d) {
+        s -= L[i + d][d] * c[i + d];
+      }
+      c[i] = s / L[i][0];
+    }
+  }
+}
@@ -0,0 +1,72 @@
+/**
+ * MuDirac - A muonic atom Dirac equation solver
+ * by Simone Sturniolo (2019-2020)
+ *
+ * bspline.hpp
+ *
+ * B-spline basis sets and the linear algebra needed to solve the radial Dirac
+ * equation by diagonalisation - header file
+ *
+ * @author Simone Sturniolo
+ * @version 1.0 20/03/2020
+ */
+
+#include "constants.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+#ifndef MUDIRAC_BSPLINE
+#define MUDIRAC_BSPLINE
+
+/**
+ * @class BSplineBasis
+ *
+ * @brief  A set of B-splines of given order defined on a knot sequence
+ * @note   A set of B-splines of given order (degree + 1) defined on a
+ * non-decreasing knot sequence t. There are t.size()-order splines, and in
+ * each interval [t_i, t_i+1) only the order splines i-order+1, ..., i are
+ * non-zero.
+ */
+class BSplineBasis {
+ private:
+  vector<double> t;
+  int order;
+
+ public:
+  BSplineBasis(vector<double> t, int order = 8);
+
+  int size() {
+    return t.size() - order;
+  };
+  int getOrder() {
+    return order;
+  };
+  vector<double> getKnots() {
+    return t;
+  };
+
+  int findInterval(double x);
+  int evaluate(double x, vector<vector<double>> &ders, int nder = 0);
+  void quadrature(int nq, vector<double> &x, vector<double> &w);
+};
+
+void gaussLegendre(int n, vector<double> &x, vector<double> &w);
+
+void dkbDiracMatrices(BSplineBasis &basis, vector<double> rq, vector<double> wq,
+                      vector<double> Vq, int k, double m,
+                      vector<vector<double>> &H, vector<vector<double>> &S);
+void dkbDiracWavefunction(BSplineBasis &basis, vector<double> c, int k,
+                          double m, vector<double> r, vector<double> &P,
+                          vector<double> &Q);
+
+void bandCholesky(vector<vector<double>> &A);
+void symmetricEigen(vector<vector<double>> &A, vector<double> &evals);
+void generalizedBandEigen(vector<vector<double>> H, vector<vector<double>> S,
+                          vector<double> &evals,
+                          vector<vector<double>> &evecs);
+
+#endif
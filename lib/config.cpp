@@ -20,11 +20,21 @@ MuDiracInputFile::MuDiracInputFile() : InputFile() {
   this->defineStringNode("nuclear_model", InputNode<string>("POINT", false)); // Model used for nucleus
   this->defineStringNode("electronic_config", InputNode<string>(""));         // Electronic configuration for background charge
   this->defineStringNode("ideal_atom_minshell", InputNode<string>(""));       // Shell above which to treat the atom as ideal, and simply use standard hydrogen-like orbitals
+  this->defineStringNode("state_cache", InputNode<string>(""));               // Directory used to store converged states between runs
+  this->defineStringNode("energy_search", InputNode<string>("NEWTON", false)); // Method used to converge the energy of states
+  this->defineStringNode("solver", InputNode<string>("SHOOTING", false));     // Method used to solve the Dirac equation
+  this->defineStringNode("shoot_method", InputNode<string>("RK4", false));    // Method used to integrate states when shooting
+  this->defineStringNode("correction_mode", InputNode<string>("FULL", false)); // How to include the Uehling and electronic background corrections
+  this->defineStringNode("sweep_param", InputNode<string>("", false));         // Nuclear or grid parameter to sweep over (RADIUS, FERMI2_T or LOGGRID_CENTER)
 
   // Boolean keywords
   this->defineBoolNode("uehling_correction", InputNode<bool>(false, false)); // Whether to use the Uehling potential correction
+  this->defineBoolNode("uehling_tabulated", InputNode<bool>(false, false));  // Whether to interpolate the Uehling potential from a precomputed table
   this->defineBoolNode("write_spec", InputNode<bool>(false, false));         // If true, write a simulated spectrum with the lines found
   this->defineBoolNode("sort_byE", InputNode<bool>(false, false));           // If true, sort output transitions by energy in report
+  this->defineBoolNode("pruefer_nodes", InputNode<bool>(true, false));       // Whether to search for the right number of nodes using the Pruefer phase
+  this->defineBoolNode("parallel_legs", InputNode<bool>(false, false));      // Whether to integrate forward and backwards on two threads
+  this->defineBoolNode("series_boundaries", InputNode<bool>(false, false));  // Whether to start integrations from series at both ends of the grid
 
   // Double keywords
   this->defineDoubleNode("mass", InputNode<double>(Physical::m_mu));      // Mass of orbiting particle (default: muon mass)
@@ -34,6 +44,10 @@ MuDiracInputFile::MuDiracInputFile() : InputFile() {
   this->defineDoubleNode("node_tol", InputNode<double>(1e-6));            // Tolerance parameter used for counting nodes in wavefunctions
   this->defineDoubleNode("loggrid_step", InputNode<double>(0.005));       // Logarithmic grid step
   this->defineDoubleNode("loggrid_center", InputNode<double>(1.0));       // Logarithmic grid center (in units of 1/(Z*m))
+  this->defineDoubleNode("shoot_tol", InputNode<double>(1e-11));          // Local error tolerance for adaptive integration (DOPRI5)
+  this->defineDoubleNode("target_line_accuracy", InputNode<double>(0));   // Accuracy required on transition energies, in eV (0 = off)
+  this->defineDoubleNode("perturbative_tol", InputNode<double>(0.1));     // Estimated second order correction above which to warn, in eV (0 = off)
+  this->defineDoubleNode("isotope_mixture_min", InputNode<double>(0));    // Fraction below which isotopes of the mixture are skipped
   this->defineDoubleNode("uehling_lowcut", InputNode<double>(0.0));       // Low cutoff parameter for Uehling potential (approximation of r ~ 0)
   this->defineDoubleNode("uehling_highcut", InputNode<double>(INFINITY)); // High cutoff parameter for Uehling potential (approximation of r >> 1/2c)
   this->defineDoubleNode("econf_rhoeps", InputNode<double>(1e-4));        // Density threshold at which to truncate the electronic charge background
@@ -53,8 +67,19 @@ MuDiracInputFile::MuDiracInputFile() : InputFile() {
   this->defineIntNode("state_print_precision", InputNode<int>(-1)); // Number of digits to print out in values in Dirac state output .{state_name}.out files
   this->defineIntNode("verbosity", InputNode<int>(1));           // Verbosity level (1 to 3)
   this->defineIntNode("output", InputNode<int>(1));              // Output level (1 to 3)
+  this->defineIntNode("nthreads", InputNode<int>(1));            // Number of threads used to converge states in parallel
+  this->defineIntNode("shoot_lanes", InputNode<int>(1));         // Number of trial energies per iteration when searching for nodes
+  this->defineIntNode("shoot_segments", InputNode<int>(1));      // Number of segments integrated in parallel when integrating a state
+  this->defineIntNode("bspline_size", InputNode<int>(100));      // Number of B-splines for the BSPLINE solver
+  this->defineIntNode("bspline_order", InputNode<int>(8));       // Order of the B-splines for the BSPLINE solver
+  this->defineIntNode("richardson_levels", InputNode<int>(1));   // Number of grids used to extrapolate energies (1 = no extrapolation)
+  this->defineIntNode("multigrid_factor", InputNode<int>(1));    // Ratio of the coarse grid step used to find states first (1 = off)
   // Vector string keywords
   this->defineStringNode("xr_lines", InputNode<string>(vector<string> {"K1-L2"}, false)); // List of spectral lines to compute
+  this->defineStringNode("isotope_shift", InputNode<string>(vector<string> {}, false));   // List of isotopes to compute the line shifts for (or ALL)
+  this->defineStringNode("isotope_mixture", InputNode<string>(vector<string> {}, false)); // List of isotopes and their abundances, as A:abundance
+  // Vector double keywords
+  this->defineDoubleNode("sweep_values", InputNode<double>(vector<double> {})); // Values of the swept parameter
 
   /* These keywords are reserved for developers and debugging */
 
@@ -64,20 +89,28 @@ MuDiracInputFile::MuDiracInputFile() : InputFile() {
   // Integer keywords
   this->defineIntNode("devel_EdEscan_k", InputNode<int>(-1));      // Value of quantum number k for E->dE scan
   this->defineIntNode("devel_EdEscan_steps", InputNode<int>(100)); // Energy steps for E->dE scan
+  this->defineIntNode("devel_dxscan_n", InputNode<int>(1));        // Principal quantum number of the state for the grid step scan
+  this->defineIntNode("devel_dxscan_k", InputNode<int>(-1));       // Value of quantum number k for the grid step scan
+  this->defineIntNode("devel_dxscan_steps", InputNode<int>(9));    // Number of grid steps in the grid step scan
 
   // Double keywords
   this->defineDoubleNode("devel_EdEscan_minE", InputNode<double>(-INFINITY)); // Minimum binding energy for E->dE scan
   this->defineDoubleNode("devel_EdEscan_maxE", InputNode<double>(0));         // Maximum binding energy for E->dE scan
+  this->defineDoubleNode("devel_dxscan_min", InputNode<double>(0.0025));      // Smallest grid step for the grid step scan
+  this->defineDoubleNode("devel_dxscan_max", InputNode<double>(0.04));        // Largest grid step for the grid step scan
 
   // Boolean keywords
   this->defineBoolNode("devel_EdEscan_log", InputNode<bool>(false, false)); // Make the energy scan logarithmic
 }
 
 DiracAtom MuDiracInputFile::makeAtom() {
+  return makeAtom(this->getIntValue("isotope"));
+}
+
+DiracAtom MuDiracInputFile::makeAtom(int A) {
   // Now extract the relevant parameters
   int Z = getElementZ(this->getStringValue("element"));
   double m = this->getDoubleValue("mass");
-  int A = this->getIntValue("isotope");
   if (A == -1) {
     A = getElementMainIsotope(Z);
   }
@@ -102,17 +135,50 @@ DiracAtom MuDiracInputFile::makeAtom() {
   da.Etol = this->getDoubleValue("energy_tol");
   da.Edamp = this->getDoubleValue("energy_damp");
   da.max_dE_ratio = this->getDoubleValue("max_dE_ratio");
+  if (esearchmap.find(this->getStringValue("energy_search")) == esearchmap.end()) {
+    throw invalid_argument("Invalid energy_search parameter in input file");
+  }
+  da.Esearch = esearchmap[this->getStringValue("energy_search")];
   da.nodetol = this->getDoubleValue("node_tol");
   da.maxit_E = this->getIntValue("max_E_iter");
   da.maxit_nodes = this->getIntValue("max_nodes_iter");
   da.maxit_state = this->getIntValue("max_state_iter");
+  da.nthreads = this->getIntValue("nthreads");
+  da.shoot_lanes = this->getIntValue("shoot_lanes");
+  da.shoot_segments = this->getIntValue("shoot_segments");
+  da.pruefer_nodes = this->getBoolValue("pruefer_nodes");
+  da.parallel_legs = this->getBoolValue("parallel_legs");
+  da.series_boundaries = this->getBoolValue("series_boundaries");
+  if (solvermap.find(this->getStringValue("solver")) == solvermap.end()) {
+    throw invalid_argument("Invalid solver parameter in input file");
+  }
+  da.solver = solvermap[this->getStringValue("solver")];
+  if (shootmethodmap.find(this->getStringValue("shoot_method")) == shootmethodmap.end()) {
+    throw invalid_argument("Invalid shoot_method parameter in input file");
+  }
+  da.shoot_method = shootmethodmap[this->getStringValue("shoot_method")];
+  da.shoot_tol = this->getDoubleValue("shoot_tol");
+  da.richardson_levels = this->getIntValue("richardson_levels");
+  da.multigrid_factor = this->getIntValue("multigrid_factor");
+  da.setTargetAccuracy(this->getDoubleValue("target_line_accuracy") * Physical::eV);
+  da.bspline_size = this->getIntValue("bspline_size");
+  da.bspline_order = this->getIntValue("bspline_order");
+
+  if (corrmodemap.find(this->getStringValue("correction_mode")) == corrmodemap.end()) {
+    throw invalid_argument("Invalid correction_mode parameter in input file");
+  }
+  da.setCorrectionMode(corrmodemap[this->getStringValue("correction_mode")]);
+  da.perturbative_tol = this->getDoubleValue("perturbative_tol") * Physical::eV;
 
   if (this->getBoolValue("uehling_correction")) {
     da.setUehling(true, this->getIntValue("uehling_steps"),
                   this->getDoubleValue("uehling_lowcut"),
-                  this->getDoubleValue("uehling_highcut"));
+                  this->getDoubleValue("uehling_highcut"),
+                  this->getBoolValue("uehling_tabulated"));
   }
 
+  da.setStateCache(this->getStringValue("state_cache"));
+
   if (this->getStringValue("electronic_config") != "") {
     double e_mu = effectiveMass(1.0, da.getM() * Physical::amu);
     LOG(TRACE) << "Electronic effective mass: " << e_mu << "\n";
@@ -38,11 +38,25 @@ class MuDiracInputFile : public InputFile {
  public:
   MuDiracInputFile(void);
   DiracAtom makeAtom();
+  DiracAtom makeAtom(int A);
 
  private:
   map<string, NuclearRadiusModel> nucmodelmap = {
     {"POINT", POINT}, {"SPHERE", SPHERE}, {"FERMI2", FERMI2}
   };
+  map<string, EnergySearchMethod> esearchmap = {
+    {"DAMPED", DAMPED_NEWTON}, {"NEWTON", SAFE_NEWTON}
+  };
+  map<string, DiracSolverMethod> solvermap = {
+    {"SHOOTING", SHOOTING}, {"BSPLINE", BSPLINE}
+  };
+  map<string, DiracIntegrator> shootmethodmap = {
+    {"RK4", RK4_AVERAGED}, {"RK4_MIDPOINT", RK4_MIDPOINT}, {"AM6", ADAMS_MOULTON6},
+    {"DOPRI5", DORMAND_PRINCE}
+  };
+  map<string, CorrectionMode> corrmodemap = {
+    {"FULL", FULL_CORRECTIONS}, {"PERTURBATIVE", PERTURBATIVE_CORRECTIONS}
+  };
 };
 
 #endif
\ No newline at end of file
@@ -61,4 +61,60 @@ void runEdEscan(MuDiracInputFile infile) {
   string fname = "EdEscan_" + to_string(k) + ".dat";
 
   writeEdEscan(Erange, dEs, nodes, fname);
-}
\ No newline at end of file
+}
+
+void runDxScan(MuDiracInputFile infile) {
+  DiracAtom da = infile.makeAtom();
+
+  int n = infile.getIntValue("devel_dxscan_n");
+  int k = infile.getIntValue("devel_dxscan_k");
+  int ndx = infile.getIntValue("devel_dxscan_steps");
+  double mindx = infile.getDoubleValue("devel_dxscan_min");
+  double maxdx = infile.getDoubleValue("devel_dxscan_max");
+
+  if (da.getR() > 0) {
+    LOG(WARNING) << "Grid step scan compares with the energy for a point nucleus, but nuclear_model is not POINT\n";
+  }
+
+  double Eref = hydrogenicDiracEnergy(da.getZ(), da.getmu(), n, k, true);
+  vector<DiracIntegrator> methods = {RK4_AVERAGED, RK4_MIDPOINT, ADAMS_MOULTON6};
+  vector<string> names = {"RK4", "RK4_MIDPOINT", "AM6"};
+
+  // Steps go from the largest to the smallest, evenly spaced in logarithm
+  vector<double> dxs(ndx);
+  vector<int> npoints(ndx, 0);
+  vector<vector<double>> errs(methods.size(), vector<double>(ndx, NAN));
+
+  for (int i = 0; i < ndx; ++i) {
+    dxs[i] = (ndx > 1) ? maxdx * pow(mindx / maxdx, i / (ndx - 1.0)) : maxdx;
+  }
+
+  for (int j = 0; j < (int)methods.size(); ++j) {
+    int best = -1;
+    for (int i = 0; i < ndx; ++i) {
+      da.setgrid(da.getrc(), dxs[i]);
+      da.shoot_method = methods[j];
+      try {
+        DiracState ds = da.convergeState(n, k);
+        npoints[i] = ds.grid.size();
+        errs[j][i] = ds.E - da.getRestE() - Eref;
+      } catch (...) {
+        LOG(WARNING) << "Could not converge state with " << names[j] << " and dx = " << dxs[i] << "\n";
+        continue;
+      }
+      LOG(TRACE) << names[j] << ", dx = " << dxs[i] << ": error = " << errs[j][i] / Physical::eV << " eV\n";
+      if (best < 0 && abs(errs[j][i] / Physical::eV) < 1e-3) {
+        best = i;
+      }
+    }
+    if (best >= 0) {
+      LOG(INFO) << names[j] << " reaches 1e-3 eV with dx = " << dxs[best] << " (" << npoints[best] << " points)\n";
+    } else {
+      LOG(INFO) << names[j] << " does not reach 1e-3 eV in the range of dx scanned\n";
+    }
+  }
+
+  string fname = "dxscan_" + to_string(n) + "_" + to_string(k) + ".dat";
+
+  writeDxScan(dxs, npoints, errs, fname);
+}
@@ -25,5 +25,6 @@ using namespace std;
 #define MUDIRAC_DEBUGTASKS
 
 void runEdEscan(MuDiracInputFile infile);
+void runDxScan(MuDiracInputFile infile);
 
 #endif
\ No newline at end of file
@@ -40,7 +40,7 @@ TurningPointError::TurningPointError(TPEType t) {
  * @param  y: function values
  * @retval Integral
  */
-double trapzInt(vector<double> x, vector<double> y) {
+double trapzInt(ArrayView x, ArrayView y) {
   int N = y.size();
   double ans = 0.0;
 
@@ -65,7 +65,7 @@ double trapzInt(vector<double> x, vector<double> y) {
  * @param  y:   function values
  * @retval Integral
  */
-double trapzInt(double dx, vector<double> y) {
+double trapzInt(double dx, ArrayView y) {
   int N = y.size();
   double ans = 0.0;
 
@@ -123,7 +123,7 @@ double stepRungeKutta(double Q0, double A0, double A1, double B0, double B1, dou
  * @param  dir: Integration direction, either forward 'f' or backwards 'b' (default = 'f').
  * @retval None
  */
-void shootRungeKutta(vector<double> &Q, vector<double> A, vector<double> B, double h, int stop_i, char dir) {
+void shootRungeKutta(vector<double> &Q, ArrayView A, ArrayView B, double h, int stop_i, char dir) {
   int N = Q.size();
   int step = (dir == 'f') ? 1 : -1;
   int from_i = (step == 1) ? 1 : N - 2;
@@ -164,7 +164,7 @@ void shootRungeKutta(vector<double> &Q, vector<double> A, vector<double> B, doub
  * @param  dir: Integration direction, either forward 'f' or backwards 'b' (default = 'f').
  * @retval None
  */
-void shootQP(vector<double> &Q, vector<double> &P, vector<double> AA, vector<double> AB, vector<double> BA, vector<double> BB,
+void shootQP(vector<double> &Q, vector<double> &P, ArrayView AA, ArrayView AB, ArrayView BA, ArrayView BB,
              double h, int stop_i, char dir) {
   int N = Q.size();
   int step = (dir == 'f') ? 1 : -1;
@@ -223,7 +223,7 @@ void shootQP(vector<double> &Q, vector<double> &P, vector<double> AA, vector<dou
  * @param  dir: Integration direction, either forward 'f' or backwards 'b' (default = 'f').
  * @retval None
  */
-void shootNumerov(vector<double> &Q, vector<double> A, vector<double> B, double h, int stop_i, char dir) {
+void shootNumerov(vector<double> &Q, ArrayView A, ArrayView B, double h, int stop_i, char dir) {
 
   int N = Q.size();
   int step = (dir == 'f') ? 1 : -1;
@@ -265,7 +265,7 @@ void shootNumerov(vector<double> &Q, vector<double> A, vector<double> B, double
  * @param  h:    Integration step (default = 1)
  * @retval None
  */
-void shootPotentialLog(vector<double> &V, vector<double> rho, double h) {
+void shootPotentialLog(vector<double> &V, ArrayView rho, double h) {
   int N = V.size();
   double h2 = h * h;
   double A0, A1, A2, A3;
@@ -285,6 +285,547 @@ void shootPotentialLog(vector<double> &V, vector<double> rho, double h) {
   }
 }
 
+/**
+ * @brief  Integrate the radial Dirac equation over a range of points with adaptive steps
+ * @note   Perform the same integration as shootDiracLogRange with the fifth order Dormand-Prince
+ * method, choosing the steps in x = log(r/rc) so that the local error estimated from the embedded
+ * fourth order solution stays below tol times the size of the solution. Steps are not tied to the
+ * grid: the values at the grid points crossed by each step are found with the continuous extension
+ * of the method, and the potential is computed wherever it is needed with Vfunc.
+ *
+ * @param  &Q:      Vector for Q
+ * @param  &P:      Vector for P
+ * @param  r:       Radial (logarithmic) grid
+ * @param  Vfunc:   Potential as a function of r
+ * @param  B:       Binding energy (E - mc^2)
+ * @param  k:       Quantum number
+ * @param  m:       Mass of the particle
+ * @param  dx:      Grid step
+ * @param  from_i:  First point to integrate
+ * @param  to_i:    Last point to integrate
+ * @param  step:    Direction of integration (1 or -1)
+ * @param  Q0:      Value of Q at from_i-step
+ * @param  P0:      Value of P at from_i-step
+ * @param  store_last: If false, the value at to_i is not stored in Q and P
+ * @param  &Qt:     Value of Q at to_i
+ * @param  &Pt:     Value of P at to_i
+ * @param  tol:     Relative tolerance on the local error
+ * @retval None
+ */
+static void shootDiracLogAdaptive(vector<double> &Q, vector<double> &P, ArrayView r,
+                                  const function<double(double)> &Vfunc, double B, int k, double m, double dx,
+                                  int from_i, int to_i, int step, double Q0, double P0, bool store_last,
+                                  double &Qt, double &Pt, double tol) {
+  // Dormand-Prince coefficients, with the error weights (difference between
+  // the fifth and fourth order solutions) and those of the continuous
+  // extension, as in E. Hairer, S. P. Norsett, G. Wanner, "Solving Ordinary
+  // Differential Equations I" (1993)
+  static const double c[7] = {0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1, 1};
+  static const double a[7][6] = {
+    {0, 0, 0, 0, 0, 0},
+    {1.0 / 5, 0, 0, 0, 0, 0},
+    {3.0 / 40, 9.0 / 40, 0, 0, 0, 0},
+    {44.0 / 45, -56.0 / 15, 32.0 / 9, 0, 0, 0},
+    {19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729, 0, 0},
+    {9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656, 0},
+    {35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84}
+  };
+  static const double e[7] = {71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525,
+                              -1.0 / 40
+                             };
+  static const double d[7] = {-12715105075.0 / 11282082432, 0, 87487479700.0 / 32700410799,
+                              -10690763975.0 / 1880347072, 701980252875.0 / 199316789632,
+                              -1453857185.0 / 822651844, 69997945.0 / 29380423
+                             };
+
+  // x is measured from the starting point
+  int i0 = from_i - step, next_i = from_i;
+  double r0 = r[i0], x = 0, x1 = (to_i - i0) * dx;
+  double h = step * dx;
+  double Qp = Q0, Pp = P0;
+  double kQ[7], kP[7];
+  int n_acc = 0, n_rej = 0;
+
+  auto deriv = [&](double x, double Qx, double Px, double &dQ, double &dP) {
+    double rx = r0 * exp(x);
+    double Vx = Vfunc(rx);
+    dQ = k * Qx - rx * (B - Vx) * Physical::alpha * Px;
+    dP = rx * ((B - Vx) * Physical::alpha + 2 * m * Physical::c) * Qx - k * Px;
+  };
+
+  deriv(x, Qp, Pp, kQ[0], kP[0]);
+  while (step * (x1 - x) > 0) {
+    if (step * (x + h - x1) > 0) {
+      h = x1 - x;
+    }
+
+    for (int s = 1; s < 7; ++s) {
+      double Qs = Qp, Ps = Pp;
+      for (int j = 0; j < s; ++j) {
+        Qs += h * a[s][j] * kQ[j];
+        Ps += h * a[s][j] * kP[j];
+      }
+      deriv(x + c[s] * h, Qs, Ps, kQ[s], kP[s]);
+    }
+    // The last stage is computed at the new point
+    double Qn = Qp, Pn = Pp, errQ = 0, errP = 0;
+    for (int j = 0; j < 6; ++j) {
+      Qn += h * a[6][j] * kQ[j];
+      Pn += h * a[6][j] * kP[j];
+    }
+    for (int j = 0; j < 7; ++j) {
+      errQ += h * e[j] * kQ[j];
+      errP += h * e[j] * kP[j];
+    }
+
+    double scale = tol * max(max(abs(Qp), abs(Pp)), max(abs(Qn), abs(Pn)));
+    double err = max(abs(errQ), abs(errP)) / scale;
+
+    if (err <= 1) {
+      double xn = (step * (x + h - x1) >= 0) ? x1 : x + h;
+      // Continuous extension for the grid points within the step
+      double dQ = Qn - Qp, dP = Pn - Pp;
+      double bQ = h * kQ[0] - dQ, bP = h * kP[0] - dP;
+      double cQ = dQ - h * kQ[6] - bQ, cP = dP - h * kP[6] - bP;
+      double eQ = 0, eP = 0;
+      for (int j = 0; j < 7; ++j) {
+        eQ += h * d[j] * kQ[j];
+        eP += h * d[j] * kP[j];
+      }
+      for (; step * (to_i - next_i) >= 0 && step * ((next_i - i0) * dx - xn) <= 0; next_i += step) {
+        double th = ((next_i - i0) * dx - x) / h, th1 = 1 - th;
+        double Qi = Qp + th * (dQ + th1 * (bQ + th * (cQ + th1 * eQ)));
+        double Pi = Pp + th * (dP + th1 * (bP + th * (cP + th1 * eP)));
+        if (next_i == to_i) {
+          Qi = Qn;
+          Pi = Pn;
+          if (!store_last) {
+            continue;
+          }
+        }
+        Q[next_i] = Qi;
+        P[next_i] = Pi;
+      }
+      x = xn;
+      Qp = Qn;
+      Pp = Pn;
+      kQ[0] = kQ[6];
+      kP[0] = kP[6];
+      n_acc++;
+    } else {
+      n_rej++;
+    }
+
+    h *= (err > 0) ? min(5.0, max(0.2, 0.9 * pow(err, -0.2))) : 5.0;
+    if (abs(h) < 1e-10 * dx) {
+      throw runtime_error("Step too small in adaptive integration");
+    }
+  }
+
+  LOG(TRACE) << "Adaptive integration over " << abs(to_i - i0) << " grid points: " << n_acc << " steps, " << n_rej
+             << " rejected\n";
+
+  Qt = Qp;
+  Pt = Pp;
+}
+
+/**
+ * @brief  Take one step of the integration of d/dE (Q/P)
+ * @note   Take one step of the integration of zeta = d/dE (Q/P) from the point r0, where Q/P = y0,
+ * to r1, where Q/P = y1 (see shootDiracErrorDELog). Where Q/P is large, the equation for d/dE (P/Q)
+ * is integrated instead.
+ *
+ * @param  zeta0:   Value of zeta at r0
+ * @param  y0:      Q/P at r0
+ * @param  y1:      Q/P at r1
+ * @param  r0:      Starting radius
+ * @param  r1:      End radius
+ * @param  V1:      Potential at r1
+ * @param  E:       Energy (binding + mc^2)
+ * @param  k:       Quantum number
+ * @param  mc:      Mass of the particle times c
+ * @param  dx:      Integration step
+ * @param  step:    Direction of integration (1 or -1)
+ * @retval          Value of zeta at r1
+ */
+static double stepDiracErrorDE(double zeta0, double y0, double y1, double r0, double r1, double V1, double E,
+                               int k, double mc, double dx, int step) {
+  double g, A0, A1, B0, B1, y02, y12;
+
+  if (abs(y1) < Physical::alpha || zeta0 == 0) {
+    g = (mc + (E - V1) * Physical::alpha);
+    A0 = 2*(k-g*r0*y0);
+    A1 = 2*(k-g*r1*y1);
+    B0 = -r0*(1+pow(y0, 2))*Physical::alpha;
+    B1 = -r1*(1+pow(y1, 2))*Physical::alpha;
+
+    return stepRungeKutta(zeta0, A0, A1, B0, B1, dx, step);
+  } else {
+    g = (mc - (E - V1) * Physical::alpha);
+    y02 = pow(y0, 2);
+    y12 = pow(y1, 2);
+    A0 = -2*(k+g*r0/y0);
+    A1 = -2*(k+g*r1/y1);
+    B0 = r0*(1+1/y02)*Physical::alpha;
+    B1 = r1*(1+1/y12)*Physical::alpha;
+
+    return -y12*stepRungeKutta(-zeta0/y02, A0, A1, B0, B1, dx, step);
+  }
+}
+
+/**
+ * @brief  Integrate the radial Dirac equation on a logarithmic grid over a range of points
+ * @note   Integrate the radial Dirac equation (see shootDiracLog) from the point from_i-step, where
+ * Q = Q0 and P = P0, to to_i, storing the results in Q and P. The coefficients are computed as
+ * needed rather than stored. With RK4_AVERAGED the steps are the same as in shootQP. The other
+ * methods need the potential at the midpoints between grid points: RK4_MIDPOINT takes the same
+ * Runge-Kutta steps with the exact coefficients there, so that its error is of fourth order in dx
+ * rather than second, while ADAMS_MOULTON6 takes four of those steps and then continues with the
+ * sixth order Adams-Moulton formula
+ *
+ *      y[n+1] = y[n] + h/1440*(475*f[n+1] + 1427*f[n] - 798*f[n-1] + 482*f[n-2] - 173*f[n-3] + 27*f[n-4])
+ *
+ * which only needs the coefficients at the grid points. Since the equations are linear, the
+ * implicit formula is solved exactly for y[n+1]. DORMAND_PRINCE uses adaptive steps instead (see
+ * shootDiracLogAdaptive) and computes the potential with Vfunc.
+ *
+ * @param  &Q:      Vector for Q
+ * @param  &P:      Vector for P
+ * @param  r:       Radial (logarithmic) grid
+ * @param  V:       Potential
+ * @param  B:       Binding energy (E - mc^2)
+ * @param  k:       Quantum number
+ * @param  m:       Mass of the particle
+ * @param  dx:      Integration step
+ * @param  from_i:  First point to integrate
+ * @param  to_i:    Last point to integrate
+ * @param  step:    Direction of integration (1 or -1)
+ * @param  Q0:      Value of Q at from_i-step
+ * @param  P0:      Value of P at from_i-step
+ * @param  store_last: If false, the value at to_i is not stored in Q and P
+ * @param  &Qt:     Value of Q at to_i
+ * @param  &Pt:     Value of P at to_i
+ * @param  Vmid:    Potential at the midpoints, Vmid[i] between r[i] and r[i+1] (only used by
+ * RK4_MIDPOINT and ADAMS_MOULTON6)
+ * @param  method:  Integration method
+ * @param  Vfunc:   Potential as a function of r (only used by DORMAND_PRINCE)
+ * @param  tol:     Tolerance on the local error (only used by DORMAND_PRINCE)
+ * @param  E:       Energy (binding + mc^2), only needed for zeta
+ * @param  *zeta:   If not NULL, d/dE (Q/P) is integrated as well (see shootDiracErrorDELog); it
+ * must contain its value at from_i-step, and will contain the one at to_i. Set to NAN with
+ * DORMAND_PRINCE, which does not integrate it
+ * @retval None
+ */
+static void shootDiracLogRange(vector<double> &Q, vector<double> &P, ArrayView r, ArrayView V, double B, int k,
+                               double m, double dx, int from_i, int to_i, int step, double Q0, double P0,
+                               bool store_last, double &Qt, double &Pt, ArrayView Vmid,
+                               DiracIntegrator method, const function<double(double)> &Vfunc, double tol,
+                               double E = NAN, double *zeta = NULL) {
+  double h = dx * step;
+
+  if (method == DORMAND_PRINCE) {
+    shootDiracLogAdaptive(Q, P, r, Vfunc, B, k, m, dx, from_i, to_i, step, Q0, P0, store_last, Qt, Pt, tol);
+    if (zeta != NULL) {
+      *zeta = NAN;
+    }
+    return;
+  }
+
+  // Q/P at the last point, for the integration of zeta
+  double yp = Q0 / P0, mc = m * Physical::c;
+  auto stepZeta = [&](int i, double Qn, double Pn) {
+    double y1 = Qn / Pn;
+    *zeta = stepDiracErrorDE(*zeta, yp, y1, r[i - step], r[i], V[i], E, k, mc, dx, step);
+    yp = y1;
+  };
+
+  // The coefficients of the equations are AA = k, BB = -k and
+  auto coefAB = [&](int i) {
+    return -r[i] * (B - V[i]) * Physical::alpha;
+  };
+  auto coefBA = [&](int i) {
+    return r[i] * ((B - V[i]) * Physical::alpha + 2 * m * Physical::c);
+  };
+
+  double AB0 = coefAB(from_i - step), BA0 = coefBA(from_i - step);
+  double Qp = Q0, Pp = P0;
+
+  if (method != RK4_AVERAGED) {
+    double emid = exp(dx / 2);
+    // Derivatives of Q and P in x at the last five points, latest first
+    double fQ[5], fP[5];
+    int nf = 0;
+    auto pushDerivatives = [&](double AB, double BA) {
+      for (int j = 4; j > 0; --j) {
+        fQ[j] = fQ[j - 1];
+        fP[j] = fP[j - 1];
+      }
+      fQ[0] = k * Qp + AB * Pp;
+      fP[0] = BA * Qp - k * Pp;
+      nf = min(nf + 1, 5);
+    };
+
+    pushDerivatives(AB0, BA0);
+    for (int i = from_i; step * (i - to_i) <= 0; i += step) {
+      double AB1 = coefAB(i), BA1 = coefBA(i);
+
+      if (method == ADAMS_MOULTON6 && nf == 5) {
+        double c = 475.0 / 1440.0 * h;
+        double RQ = Qp + h / 1440.0 * (1427 * fQ[0] - 798 * fQ[1] + 482 * fQ[2] - 173 * fQ[3] + 27 * fQ[4]);
+        double RP = Pp + h / 1440.0 * (1427 * fP[0] - 798 * fP[1] + 482 * fP[2] - 173 * fP[3] + 27 * fP[4]);
+        double det = (1 - c * k) * (1 + c * k) - c * c * AB1 * BA1;
+
+        Qp = ((1 + c * k) * RQ + c * AB1 * RP) / det;
+        Pp = (c * BA1 * RQ + (1 - c * k) * RP) / det;
+      } else {
+        int im = min(i, i - step);
+        double rmid = r[im] * emid;
+        double ABmid = -rmid * (B - Vmid[im]) * Physical::alpha;
+        double BAmid = rmid * ((B - Vmid[im]) * Physical::alpha + 2 * m * Physical::c);
+        double k1A = (k * Qp + AB0 * Pp) * h;
+        double k1B = (BA0 * Qp - k * Pp) * h;
+        double k2A = (k * (Qp + k1A / 2.0) + ABmid * (Pp + k1B / 2.0)) * h;
+        double k2B = (BAmid * (Qp + k1A / 2.0) - k * (Pp + k1B / 2.0)) * h;
+        double k3A = (k * (Qp + k2A / 2.0) + ABmid * (Pp + k2B / 2.0)) * h;
+        double k3B = (BAmid * (Qp + k2A / 2.0) - k * (Pp + k2B / 2.0)) * h;
+        double k4A = (k * (Qp + k3A) + AB1 * (Pp + k3B)) * h;
+        double k4B = (BA1 * (Qp + k3A) - k * (Pp + k3B)) * h;
+
+        Qp = Qp + 1.0 / 6.0 * (k1A + 2 * k2A + 2 * k3A + k4A);
+        Pp = Pp + 1.0 / 6.0 * (k1B + 2 * k2B + 2 * k3B + k4B);
+      }
+      if (i != to_i || store_last) {
+        Q[i] = Qp;
+        P[i] = Pp;
+      }
+      if (zeta != NULL) {
+        stepZeta(i, Qp, Pp);
+      }
+      pushDerivatives(AB1, BA1);
+      AB0 = AB1;
+      BA0 = BA1;
+    }
+
+    Qt = Qp;
+    Pt = Pp;
+    return;
+  }
+
+  for (int i = from_i; step * (i - to_i) <= 0; i += step) {
+    double AB1 = coefAB(i), BA1 = coefBA(i);
+    double ABmid = (AB1 + AB0) / 2;
+    double BAmid = (BA1 + BA0) / 2;
+    double k1A = (k * Qp + AB0 * Pp) * h;
+    double k1B = (BA0 * Qp - k * Pp) * h;
+    double k2A = (k * (Qp + k1A / 2.0) + ABmid * (Pp + k1B / 2.0)) * h;
+    double k2B = (BAmid * (Qp + k1A / 2.0) - k * (Pp + k1B / 2.0)) * h;
+    double k3A = (k * (Qp + k2A / 2.0) + ABmid * (Pp + k2B / 2.0)) * h;
+    double k3B = (BAmid * (Qp + k2A / 2.0) - k * (Pp + k2B / 2.0)) * h;
+    double k4A = (k * (Qp + k3A) + AB1 * (Pp + k3B)) * h;
+    double k4B = (BA1 * (Qp + k3A) - k * (Pp + k3B)) * h;
+
+    Qp = Qp + 1.0 / 6.0 * (k1A + 2 * k2A + 2 * k3A + k4A);
+    Pp = Pp + 1.0 / 6.0 * (k1B + 2 * k2B + 2 * k3B + k4B);
+    if (i != to_i || store_last) {
+      Q[i] = Qp;
+      P[i] = Pp;
+    }
+    if (zeta != NULL) {
+      stepZeta(i, Qp, Pp);
+    }
+    AB0 = AB1;
+    BA0 = BA1;
+  }
+
+  Qt = Qp;
+  Pt = Pp;
+}
+
+/**
+ * @brief  Integrate the radial Dirac equation on a logarithmic grid in one direction
+ * @note   Perform one of the two integrations of shootDiracLog, either forward from the first point
+ * or backwards from the last one, up to the turning point. The forward integration does not write
+ * the value at the turning point in Q and P, which belong there to the backwards one, so that the
+ * two can run at the same time.
+ *
+ * @param  &Q:      Vector for Q (see shootDiracLog)
+ * @param  &P:      Vector for P (see shootDiracLog)
+ * @param  r:       Radial (logarithmic) grid
+ * @param  V:       Potential
+ * @param  B:       Binding energy (E - mc^2)
+ * @param  k:       Quantum number
+ * @param  m:       Mass of the particle
+ * @param  dx:      Integration step
+ * @param  turn_i:  Index of the turning point
+ * @param  step:    Direction of integration (1 or -1)
+ * @param  &Qt:     Value of Q at the turning point
+ * @param  &Pt:     Value of P at the turning point
+ * @param  Vmid:    Potential at the midpoints (see shootDiracLogRange)
+ * @param  method:  Integration method
+ * @param  Vfunc:   Potential as a function of r (see shootDiracLogRange)
+ * @param  tol:     Tolerance on the local error (see shootDiracLogRange)
+ * @param  E:       Energy (binding + mc^2), only needed for zeta
+ * @param  *zeta:   If not NULL, d/dE (Q/P) at the first point, then at the turning point (see
+ * shootDiracLogRange)
+ * @retval None
+ */
+static void shootDiracLogLeg(vector<double> &Q, vector<double> &P, ArrayView r, ArrayView V, double B, int k,
+                             double m, double dx, int turn_i, int step, double &Qt, double &Pt, ArrayView Vmid,
+                             DiracIntegrator method, const function<double(double)> &Vfunc, double tol,
+                             double E, double *zeta) {
+  int N = Q.size();
+  int from_i = (step == 1) ? 1 : N - 2;
+
+  shootDiracLogRange(Q, P, r, V, B, k, m, dx, from_i, turn_i, step, Q[from_i - step], P[from_i - step],
+                     step == -1, Qt, Pt, Vmid, method, Vfunc, tol, E, zeta);
+}
+
+/**
+ * @brief  Run tasks in parallel
+ * @note   Run each of the given tasks on its own thread (the last one on the calling thread) and wait
+ * for all of them to finish.
+ *
+ * @param  &tasks:  Tasks to run
+ * @retval None
+ */
+static void runParallel(vector<function<void()>> &tasks) {
+  vector<thread> pool;
+
+  for (int t = 0; t + 1 < (int)tasks.size(); ++t) {
+    pool.push_back(thread(tasks[t]));
+  }
+  if (tasks.size() > 0) {
+    tasks.back()();
+  }
+  for (int t = 0; t < (int)pool.size(); ++t) {
+    pool[t].join();
+  }
+}
+
+/**
+ * @brief  Integrate the radial Dirac equation on a logarithmic grid by multiple shooting
+ * @note   Perform the same integrations as shootDiracLog, with each of the two legs cut into up to
+ * nseg segments which are integrated at the same time. Since the equations are linear, the solution
+ * on each segment after the first is a combination
+ *
+ *      (Q, P) = a*(Q_a, P_a) + b*(Q_b, P_b)
+ *
+ * of the two solutions starting from (1, 0) and (0, 1) at its first point; a and b are its values
+ * there, found by joining the segments in order, and the segments are then combined at the same
+ * time too. The result is the same as that of a single integration, up to rounding errors, except
+ * with ADAMS_MOULTON6 and DORMAND_PRINCE, which start again at each segment; then the two differ
+ * by about as much as the error of the integration itself.
+ *
+ * @param  &Q:      Vector for Q (see shootDiracLog)
+ * @param  &P:      Vector for P (see shootDiracLog)
+ * @param  r:       Radial (logarithmic) grid
+ * @param  V:       Potential
+ * @param  B:       Binding energy (E - mc^2)
+ * @param  k:       Quantum number
+ * @param  m:       Mass of the particle
+ * @param  dx:      Integration step
+ * @param  turn_i:  Index of the turning point
+ * @param  nseg:    Maximum number of segments per leg
+ * @param  &out:    Turning point; Qi, Pi, Qe and Pe are set
+ * @param  Vmid:    Potential at the midpoints (see shootDiracLogRange)
+ * @param  method:  Integration method
+ * @param  Vfunc:   Potential as a function of r (see shootDiracLogRange)
+ * @param  tol:     Tolerance on the local error (see shootDiracLogRange)
+ * @retval None
+ */
+static void shootDiracLogSegments(vector<double> &Q, vector<double> &P, ArrayView r, ArrayView V, double B,
+                                  int k, double m, double dx, int turn_i, int nseg, TurningPoint &out,
+                                  ArrayView Vmid, DiracIntegrator method, const function<double(double)> &Vfunc,
+                                  double tol) {
+  int N = Q.size();
+  // Segments shorter than this are not worth a thread
+  const int min_seg = 64;
+  vector<double> Qb(N), Pb(N);
+  vector<function<void()>> tasks;
+  // Segment bounds for each leg: segment j covers the points from
+  // bounds[j]+step to bounds[j+1]
+  vector<int> bounds[2];
+  vector<double> a[2], b[2];
+
+  for (int leg = 0; leg < 2; ++leg) {
+    int step = (leg == 0) ? 1 : -1;
+    int s0 = (leg == 0) ? 0 : N - 1;
+    // The forward leg stores values up to turn_i-1; the last step is taken
+    // on its own after joining
+    int s1 = (leg == 0) ? turn_i - 1 : turn_i;
+    int len = abs(s1 - s0);
+    int K = max(1, min(nseg, len / min_seg));
+
+    for (int j = 0; j <= K; ++j) {
+      bounds[leg].push_back(s0 + step * (int)round(j * len / (double)K));
+    }
+    a[leg] = vector<double>(K, 1.0);
+    b[leg] = vector<double>(K, 0.0);
+
+    for (int j = 0; j < K; ++j) {
+      int from_i = bounds[leg][j] + step, to_i = bounds[leg][j + 1];
+      if (from_i * step > to_i * step) {
+        continue;
+      }
+      if (j == 0) {
+        tasks.push_back([&, from_i, to_i, step]() {
+          double Qt, Pt;
+          shootDiracLogRange(Q, P, r, V, B, k, m, dx, from_i, to_i, step, Q[from_i - step], P[from_i - step],
+                             true, Qt, Pt, Vmid, method, Vfunc, tol);
+        });
+      } else {
+        tasks.push_back([&, from_i, to_i, step]() {
+          double Qt, Pt;
+          shootDiracLogRange(Q, P, r, V, B, k, m, dx, from_i, to_i, step, 1.0, 0.0, true, Qt, Pt,
+                             Vmid, method, Vfunc, tol);
+          shootDiracLogRange(Qb, Pb, r, V, B, k, m, dx, from_i, to_i, step, 0.0, 1.0, true, Qt, Pt,
+                             Vmid, method, Vfunc, tol);
+        });
+      }
+    }
+  }
+  runParallel(tasks);
+
+  // Join the segments in order; (a, b) are the values of Q and P at the
+  // first point of each
+  for (int leg = 0; leg < 2; ++leg) {
+    int K = bounds[leg].size() - 1;
+    for (int j = 1; j < K; ++j) {
+      int i = bounds[leg][j];
+      if (j == 1) {
+        a[leg][j] = Q[i];
+        b[leg][j] = P[i];
+      } else {
+        a[leg][j] = a[leg][j - 1] * Q[i] + b[leg][j - 1] * Qb[i];
+        b[leg][j] = a[leg][j - 1] * P[i] + b[leg][j - 1] * Pb[i];
+      }
+    }
+  }
+
+  tasks.clear();
+  for (int leg = 0; leg < 2; ++leg) {
+    int step = (leg == 0) ? 1 : -1;
+    int K = bounds[leg].size() - 1;
+    for (int j = 1; j < K; ++j) {
+      int from_i = bounds[leg][j] + step, to_i = bounds[leg][j + 1];
+      double aj = a[leg][j], bj = b[leg][j];
+      tasks.push_back([&, from_i, to_i, step, aj, bj]() {
+        for (int i = from_i; step * (i - to_i) <= 0; i += step) {
+          double Qn = aj * Q[i] + bj * Qb[i];
+          P[i] = aj * P[i] + bj * Pb[i];
+          Q[i] = Qn;
+        }
+      });
+    }
+  }
+  runParallel(tasks);
+
+  shootDiracLogRange(Q, P, r, V, B, k, m, dx, turn_i, turn_i, 1, Q[turn_i - 1], P[turn_i - 1], false, out.Qi,
+                     out.Pi, Vmid, method, Vfunc, tol);
+  out.Qe = Q[turn_i];
+  out.Pe = P[turn_i];
+}
+
 /**
  * @brief  Integrate the radial Dirac equation on a logarithmic grid
  * @note   Perform integration of the radial Dirac equation on a logarithmic grid, forward and backwards, up to the turning point.
@@ -295,7 +836,8 @@ void shootPotentialLog(vector<double> &V, vector<double> rho, double h) {
  *
  * With k the quantum number: if j=|l+s|, then k = -(j+1/2)*sign(j-l), and E the expected energy (including the rest mass term).
  * The function will return a struct containing the index of the 'turning point', where the forward and backwards integration meet,
- * as well as the values of Q and P integrated forward (Qi, Pi) and backwards (Qe, Pe) at it.
+ * as well as the values of Q and P integrated forward (Qi, Pi) and backwards (Qe, Pe) at it. The two integrations are
+ * independent, and can be run on two threads at once.
  *
  * @param  &Q: Vector for Q. Will return the integrated values, must contain already the first and last two as boundary conditions.
  * @param  &P: Vector for P. Will return the integrated values, must contain already the first and last two as boundary conditions.
@@ -305,29 +847,46 @@ void shootPotentialLog(vector<double> &V, vector<double> rho, double h) {
  * @param  k:  Quantum number (default = -1)
  * @param  m:  Mass of the particle (default = 1)
  * @param  dx: Integration step (default = 1)
+ * @param  parallel: If true, integrate forward on a separate thread (default = false)
+ * @param  nseg: If larger than 1, cut each integration in up to nseg segments integrated in parallel
+ * (see shootDiracLogSegments; default = 1)
+ * @param  Vmid: Potential at the midpoints between grid points, Vmid[i] at sqrt(r[i]*r[i+1]);
+ * only needed if method is not RK4_AVERAGED (default = empty)
+ * @param  method: Integration method (see shootDiracLogRange; default = RK4_AVERAGED)
+ * @param  Vfunc: Potential as a function of r; only needed if method is DORMAND_PRINCE (default = none)
+ * @param  tol: Relative tolerance on the local error for DORMAND_PRINCE (default = 1e-11)
+ * @param  zeta_e: Value of zeta = d/dE (Q/P) at the last point (see boundaryDiracErrorDECoulomb). If given,
+ * zeta is integrated in the same passes as Q and P, as shootDiracErrorDELog would, and its values at the
+ * turning point are returned as well; not with DORMAND_PRINCE or nseg > 1 (default = NAN, don't)
  * @retval turn_i: Turning point index
  */
-TurningPoint shootDiracLog(vector<double> &Q, vector<double> &P, vector<double> r, vector<double> V,
-                           double E, int k, double m, double dx) {
+TurningPoint shootDiracLog(vector<double> &Q, vector<double> &P, ArrayView r, ArrayView V,
+                           double E, int k, double m, double dx, bool parallel, int nseg, ArrayView Vmid,
+                           DiracIntegrator method, function<double(double)> Vfunc, double tol, double zeta_e) {
 
   int N = Q.size(), turn_i;
   double B; // Binding energy
   TurningPoint out;
-  vector<double> AA(N), AB(N), BA(N), BB(N); // Define the equation
 
   // Check size
   if (P.size() != N || r.size() != N || V.size() != N) {
     throw invalid_argument("Invalid size for one or more arrays passed to shootDiracLog");
   }
+  if ((method == RK4_MIDPOINT || method == ADAMS_MOULTON6) && Vmid.size() != N - 1) {
+    throw invalid_argument("Invalid size for midpoint potential passed to shootDiracLog");
+  }
+  if (method == DORMAND_PRINCE && !Vfunc) {
+    throw invalid_argument("Potential function needed by shootDiracLog for adaptive integration");
+  }
 
   B = E - m * pow(Physical::c, 2);
 
   // Find the turning point
-  for (turn_i = 0; turn_i < V.size(); ++turn_i) {
+  for (turn_i = 0; turn_i < N; ++turn_i) {
     if (V[turn_i] > B)
       break;
   }
-  if (turn_i >= V.size() - 1) {
+  if (turn_i >= N - 1) {
     LOG(ERROR) << "Turning point not included in range: r_max too small\n";
     // Turning point not included in range
     throw TurningPointError(TurningPointError::TPEType::RMAX_SMALL);
@@ -337,28 +896,264 @@ TurningPoint shootDiracLog(vector<double> &Q, vector<double> &P, vector<double>
     throw TurningPointError(TurningPointError::TPEType::RMIN_BIG);
   }
 
-  // Now define the other arrays
-  for (int i = 0; i < N; ++i) {
-    AA[i] = k;
-    AB[i] = -r[i] * (B - V[i]) * Physical::alpha;
-    BB[i] = -k;
-    BA[i] = r[i] * ((B - V[i]) * Physical::alpha + 2 * m * Physical::c);
-  }
+  // Zeta starts from zero at the origin
+  bool with_zeta = !std::isnan(zeta_e) && nseg <= 1 && method != DORMAND_PRINCE;
+  double zeta_i = 0;
+  double *zi = with_zeta ? &zeta_i : NULL, *ze = with_zeta ? &zeta_e : NULL;
 
-  // Integrate forward
-  shootQP(Q, P, AA, AB, BA, BB, dx, turn_i + 1);
-  out.Qi = Q[turn_i];
-  out.Pi = P[turn_i];
-  // Integrate backwards
-  shootQP(Q, P, AA, AB, BA, BB, dx, turn_i, 'b');
-  out.Qe = Q[turn_i];
-  out.Pe = P[turn_i];
+  if (nseg > 1) {
+    shootDiracLogSegments(Q, P, r, V, B, k, m, dx, turn_i, nseg, out, Vmid, method, Vfunc, tol);
+  } else if (parallel) {
+    thread fw(shootDiracLogLeg, ref(Q), ref(P), r, V, B, k, m, dx, turn_i, 1, ref(out.Qi), ref(out.Pi),
+              Vmid, method, Vfunc, tol, E, zi);
+    shootDiracLogLeg(Q, P, r, V, B, k, m, dx, turn_i, -1, out.Qe, out.Pe, Vmid, method, Vfunc, tol, E, ze);
+    fw.join();
+  } else {
+    shootDiracLogLeg(Q, P, r, V, B, k, m, dx, turn_i, 1, out.Qi, out.Pi, Vmid, method, Vfunc, tol, E, zi);
+    shootDiracLogLeg(Q, P, r, V, B, k, m, dx, turn_i, -1, out.Qe, out.Pe, Vmid, method, Vfunc, tol, E, ze);
+  }
 
   out.i = turn_i;
+  if (with_zeta) {
+    out.zetai = zeta_i;
+    out.zetae = zeta_e;
+  }
+
+  return out;
+}
+
+/**
+ * @brief  Integrate the radial Dirac equation for multiple energies at once
+ * @note   Perform the same integration as shootDiracLog for several energies
+ * ('lanes') in a single pass over a shared grid and potential. Each lane
+ * only covers its own range of indices within the shared grid. The steps are
+ * the same as in shootQP, so the results for each lane are identical to those
+ * of a separate call to shootDiracLog on the same range.
+ *
+ * @param  &Q:   Vectors for Q, one per lane, each covering the range of its
+ * lane. Will return the integrated values, must contain already the first
+ * and last two values as boundary conditions.
+ * @param  &P:   Vectors for P, as for Q.
+ * @param  r:    Radial (logarithmic) grid
+ * @param  V:    Potential
+ * @param  E:    Energies (binding + mc^2), one per lane
+ * @param  lims: First and last index of the range used by each lane
+ * @param  k:    Quantum number (default = -1)
+ * @param  m:    Mass of the particle (default = 1)
+ * @param  dx:   Integration step (default = 1)
+ * @param  *ws:  Workspace to reuse (default = NULL, use a new one)
+ * @retval       Turning points for each lane, with indices relative to
+ * the start of their range
+ */
+vector<TurningPoint> shootDiracLogBatch(vector<vector<double>> &Q, vector<vector<double>> &P, ArrayView r,
+                                        ArrayView V, ArrayView E, const vector<pair<int, int>> &lims,
+                                        int k, double m, double dx, DiracWorkspace *ws) {
+  int N = r.size(), L = E.size();
+  int fw_from = N, fw_to = 0, bw_from = 0, bw_to = N;
+  double h;
+  vector<double> B(L);
+  vector<int> first(L), last(L), turn(L);
+  vector<TurningPoint> out(L);
+  DiracWorkspace ws_local;
+
+  if (ws == NULL) {
+    ws = &ws_local;
+  }
+
+  // Check size
+  if ((int)V.size() != N || (int)Q.size() != L || (int)P.size() != L || (int)lims.size() != L) {
+    throw invalid_argument("Invalid size for one or more arrays passed to shootDiracLogBatch");
+  }
+
+  for (int l = 0; l < L; ++l) {
+    first[l] = lims[l].first;
+    last[l] = lims[l].second;
+    if (first[l] < 0 || last[l] >= N || last[l] <= first[l] || (int)Q[l].size() != last[l] - first[l] + 1 ||
+        (int)P[l].size() != last[l] - first[l] + 1) {
+      throw invalid_argument("Invalid size for one or more arrays passed to shootDiracLogBatch");
+    }
+
+    B[l] = E[l] - m * pow(Physical::c, 2);
+
+    // Find the turning point
+    for (turn[l] = first[l]; turn[l] <= last[l]; ++turn[l]) {
+      if (V[turn[l]] > B[l])
+        break;
+    }
+    if (turn[l] >= last[l]) {
+      LOG(ERROR) << "Turning point not included in range: r_max too small\n";
+      throw TurningPointError(TurningPointError::TPEType::RMAX_SMALL);
+    } else if (turn[l] == first[l]) {
+      LOG(ERROR) << "Turning point not included in range: r_min too big\n";
+      throw TurningPointError(TurningPointError::TPEType::RMIN_BIG);
+    }
+
+    fw_from = min(fw_from, first[l] + 1);
+    fw_to = max(fw_to, turn[l] + 1);
+    bw_from = max(bw_from, last[l] - 1);
+    bw_to = min(bw_to, turn[l]);
+  }
+
+  // Coefficients of all lanes, element (i, l) at i*L+l; only the range of
+  // each lane is set and used
+  vector<double> &AB = ws->AB, &BA = ws->BA;
+  AB.resize(N * L);
+  BA.resize(N * L);
+  for (int l = 0; l < L; ++l) {
+    for (int i = first[l]; i <= last[l]; ++i) {
+      AB[i * L + l] = -r[i] * (B[l] - V[i]) * Physical::alpha;
+      BA[i * L + l] = r[i] * ((B[l] - V[i]) * Physical::alpha + 2 * m * Physical::c);
+    }
+  }
+
+  // Integrate forward, then backwards
+  for (int step = 1; step >= -1; step -= 2) {
+    int from_i = (step == 1) ? fw_from : bw_from;
+    int stop_i = (step == 1) ? fw_to : bw_to;
+    h = dx * step;
+
+    for (int i = from_i; step * (i - stop_i) <= 0; i += step) {
+      int j0 = (i - step) * L, j1 = i * L;
+      for (int l = 0; l < L; ++l) {
+        if ((step == 1) ? (i <= first[l] || i > turn[l] + 1) : (i >= last[l] || i < turn[l]))
+          continue;
+        vector<double> &Ql = Q[l], &Pl = P[l];
+        int il = i - first[l];
+        double AAmid = (double(k) + k) / 2;
+        double ABmid = (AB[j1 + l] + AB[j0 + l]) / 2;
+        double BAmid = (BA[j1 + l] + BA[j0 + l]) / 2;
+        double BBmid = (double(-k) - k) / 2;
+        double Qp = Ql[il - step], Pp = Pl[il - step];
+        double k1A = (k * Qp + AB[j0 + l] * Pp) * h;
+        double k1B = (BA[j0 + l] * Qp + (-k) * Pp) * h;
+        double k2A = (AAmid * (Qp + k1A / 2.0) + ABmid * (Pp + k1B / 2.0)) * h;
+        double k2B = (BAmid * (Qp + k1A / 2.0) + BBmid * (Pp + k1B / 2.0)) * h;
+        double k3A = (AAmid * (Qp + k2A / 2.0) + ABmid * (Pp + k2B / 2.0)) * h;
+        double k3B = (BAmid * (Qp + k2A / 2.0) + BBmid * (Pp + k2B / 2.0)) * h;
+        double k4A = (k * (Qp + k3A) + AB[j1 + l] * (Pp + k3B)) * h;
+        double k4B = (BA[j1 + l] * (Qp + k3A) + (-k) * (Pp + k3B)) * h;
+
+        Ql[il] = Qp + 1.0 / 6.0 * (k1A + 2 * k2A + 2 * k3A + k4A);
+        Pl[il] = Pp + 1.0 / 6.0 * (k1B + 2 * k2B + 2 * k3B + k4B);
+      }
+    }
+
+    if (step == 1) {
+      for (int l = 0; l < L; ++l) {
+        out[l].Qi = Q[l][turn[l] - first[l]];
+        out[l].Pi = P[l][turn[l] - first[l]];
+      }
+    }
+  }
+
+  for (int l = 0; l < L; ++l) {
+    out[l].i = turn[l] - first[l];
+    out[l].Qe = Q[l][out[l].i];
+    out[l].Pe = P[l][out[l].i];
+  }
 
   return out;
 }
 
+/**
+ * @brief  Integrate the Pruefer phase of the radial Dirac equation on a logarithmic grid
+ * @note   Integrate the radial Dirac equation (see shootDiracLog) in terms of the
+ * Pruefer angle theta, defined by
+ *
+ *      P = rho*sin(theta)
+ *      S*Q = rho*cos(theta)
+ *
+ * which obeys the first order equation
+ *
+ *      theta' = [2mc+(B-V)/c]*r/S*cos(theta)^2 - k*sin(2*theta) + (B-V)/c*r*S*sin(theta)^2
+ *
+ * with B = E-mc^2 the binding energy. The constant S = c*sqrt(2m/|B|) balances
+ * the two coefficients, which would otherwise make the equation stiff far from
+ * the nucleus. The angle is integrated forward and backwards up to the turning
+ * point. The nodes of P are where theta crosses a multiple of pi. With both
+ * boundary angles taken in [0, pi), the returned phase difference
+ *
+ *      (thetaL - thetaR)/pi
+ *
+ * at the turning point is a continuous, increasing function of E, and is equal
+ * to n-|k| at the eigenvalue with principal quantum number n. No wavefunction
+ * is stored, and the angle does not depend on its magnitude.
+ *
+ * @param  QL: Value of Q at the first point of the grid
+ * @param  PL: Value of P at the first point of the grid
+ * @param  QR: Value of Q at the last point of the grid
+ * @param  PR: Value of P at the last point of the grid
+ * @param  r:  Radial (logarithmic) grid
+ * @param  V:  Potential
+ * @param  E:  Energy (binding + mc^2)
+ * @param  k:  Quantum number (default = -1)
+ * @param  m:  Mass of the particle (default = 1)
+ * @param  dx: Integration step (default = 1)
+ * @retval     Phase difference at the turning point, in units of pi
+ */
+double shootDiracPhaseLog(double QL, double PL, double QR, double PR, ArrayView r, ArrayView V,
+                          double E, int k, double m, double dx) {
+  int N = r.size(), turn_i;
+  double B = E - m * pow(Physical::c, 2);
+  double S;
+
+  if (V.size() != N) {
+    throw invalid_argument("Invalid size for one or more arrays passed to shootDiracPhaseLog");
+  }
+
+  // Find the turning point
+  for (turn_i = 0; turn_i < N; ++turn_i) {
+    if (V[turn_i] > B)
+      break;
+  }
+  if (turn_i >= N - 1) {
+    LOG(ERROR) << "Turning point not included in range: r_max too small\n";
+    throw TurningPointError(TurningPointError::TPEType::RMAX_SMALL);
+  } else if (turn_i == 0) {
+    LOG(ERROR) << "Turning point not included in range: r_min too big\n";
+    throw TurningPointError(TurningPointError::TPEType::RMIN_BIG);
+  }
+
+  S = Physical::c * sqrt(2 * m / abs(B));
+  auto coefAB = [&](int i) {
+    return -r[i] * (B - V[i]) * Physical::alpha * S;
+  };
+  auto coefBA = [&](int i) {
+    return r[i] * ((B - V[i]) * Physical::alpha + 2 * m * Physical::c) / S;
+  };
+
+  auto dtheta = [k](double t, double ab, double ba) {
+    double c = cos(t), s = sin(t);
+    return ba * c * c - 2 * k * s * c - ab * s * s;
+  };
+
+  // Boundary angles, in [0, pi)
+  double theta[2] = {atan2(PL, S * QL), atan2(PR, S * QR)};
+  for (int leg = 0; leg < 2; ++leg) {
+    int step = (leg == 0) ? 1 : -1;
+    int from_i = (leg == 0) ? 1 : N - 2;
+    double h = dx * step;
+    double t = theta[leg] + (theta[leg] < 0 ? M_PI : 0);
+    double AB0 = coefAB(from_i - step), BA0 = coefBA(from_i - step);
+
+    for (int i = from_i; step * (i - turn_i) <= 0; i += step) {
+      double AB1 = coefAB(i), BA1 = coefBA(i);
+      double ABmid = (AB1 + AB0) / 2;
+      double BAmid = (BA1 + BA0) / 2;
+      double k1 = dtheta(t, AB0, BA0) * h;
+      double k2 = dtheta(t + k1 / 2.0, ABmid, BAmid) * h;
+      double k3 = dtheta(t + k2 / 2.0, ABmid, BAmid) * h;
+      double k4 = dtheta(t + k3, AB1, BA1) * h;
+      t += 1.0 / 6.0 * (k1 + 2 * k2 + 2 * k3 + k4);
+      AB0 = AB1;
+      BA0 = BA1;
+    }
+    theta[leg] = t;
+  }
+
+  return (theta[0] - theta[1]) / M_PI;
+}
+
 /**
  * @brief  Integrate d/dE (Q/P) for a Dirac wavefunction based on a Coulomb potential
  * @note   Integrate zeta = d/dE (Q/P) for a Dirac wavefunction based on a Coulomb potential.
@@ -374,15 +1169,16 @@ TurningPoint shootDiracLog(vector<double> &Q, vector<double> &P, vector<double>
  * @param  m:       Mass of the particle (default = 1)
  * @param  dx:      Integration step (default = 1)
  * @param  dir:     Integration direction, either forward 'f' or backwards 'b' (default = 'f').
+ * @param  y_turn:  Value of Q/P to use at the turning point instead of y[turn_i], so that the forward
+ * and backwards integrations can share y (default = NAN, use y[turn_i])
  * @retval None
  */
-void shootDiracErrorDELog(vector<double> &zeta, vector<double> y, vector<double> r, vector<double> V, int turn_i,
-                          double E, int k, double m, double dx, char dir) {
+void shootDiracErrorDELog(vector<double> &zeta, ArrayView y, ArrayView r, ArrayView V, int turn_i,
+                          double E, int k, double m, double dx, char dir, double y_turn) {
   int N = zeta.size();
   int step = (dir == 'f') ? 1 : -1;
   int from_i = (step == 1) ? 1 : N - 2;
   double mc = m * Physical::c;
-  double g, A0, A1, B0, B1, y02, y12;
 
   // Check size
   if (y.size() != N || r.size() != N || V.size() != N) {
@@ -390,24 +1186,7 @@ void shootDiracErrorDELog(vector<double> &zeta, vector<double> y, vector<double>
   }
 
   for (int i = from_i; step * (i - turn_i) <= 0; i += step) {
-    if (abs(y[i]) < Physical::alpha || zeta[i-step] == 0) {
-      g = (mc + (E - V[i]) * Physical::alpha);
-      A0 = 2*(k-g*r[i-step]*y[i-step]);
-      A1 = 2*(k-g*r[i]*y[i]);
-      B0 = -r[i-step]*(1+pow(y[i-step], 2))*Physical::alpha;
-      B1 = -r[i]*(1+pow(y[i], 2))*Physical::alpha;
-
-      zeta[i] = stepRungeKutta(zeta[i-step], A0, A1, B0, B1, dx, step);
-    } else {
-      g = (mc - (E - V[i]) * Physical::alpha);
-      y02 = pow(y[i-step], 2);
-      y12 = pow(y[i], 2);
-      A0 = -2*(k+g*r[i-step]/y[i-step]);
-      A1 = -2*(k+g*r[i]/y[i]);
-      B0 = r[i-step]*(1+1/y02)*Physical::alpha;
-      B1 = r[i]*(1+1/y12)*Physical::alpha;
-
-      zeta[i] = -y12*stepRungeKutta(-zeta[i-step]/y02, A0, A1, B0, B1, dx, step);
-    }
+    double y1 = (i == turn_i && !std::isnan(y_turn)) ? y_turn : y[i];
+    zeta[i] = stepDiracErrorDE(zeta[i-step], y[i-step], y1, r[i-step], r[i], V[i], E, k, mc, dx, step);
   }
-}
\ No newline at end of file
+}
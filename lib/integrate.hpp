@@ -13,6 +13,8 @@
 #include <math.h>
 #include <vector>
 #include <stdexcept>
+#include <thread>
+#include <functional>
 #include "utils.hpp"
 #include "constants.hpp"
 #include "../vendor/aixlog/aixlog.hpp"
@@ -44,23 +46,52 @@ class TurningPointError : exception {
   string msg;
 };
 
-double trapzInt(vector<double> x, vector<double> y);
-double trapzInt(double dx, vector<double> y);
+double trapzInt(ArrayView x, ArrayView y);
+double trapzInt(double dx, ArrayView y);
 double stepRungeKutta(double Q0, double A0, double A1, double B0, double B1, double h, int step = 1);
-void shootRungeKutta(vector<double> &Q, vector<double> A, vector<double> B, double h = 1, int stop_i = -1, char dir = 'f');
-void shootQP(vector<double> &Q, vector<double> &P, vector<double> AA, vector<double> AB, vector<double> BA, vector<double> BB,
+void shootRungeKutta(vector<double> &Q, ArrayView A, ArrayView B, double h = 1, int stop_i = -1, char dir = 'f');
+void shootQP(vector<double> &Q, vector<double> &P, ArrayView AA, ArrayView AB, ArrayView BA, ArrayView BB,
              double h = 1, int stop_i = -1, char dir = 'f');
-void shootNumerov(vector<double> &Q, vector<double> A, vector<double> B, double h = 1, int stop_i = -1, char dir = 'f');
-void shootPotentialLog(vector<double> &V, vector<double> rho, double h = 1);
+void shootNumerov(vector<double> &Q, ArrayView A, ArrayView B, double h = 1, int stop_i = -1, char dir = 'f');
+void shootPotentialLog(vector<double> &V, ArrayView rho, double h = 1);
+
+// Methods for integrating the radial Dirac equation (see shootDiracLog)
+enum DiracIntegrator {
+  RK4_AVERAGED,  // Runge-Kutta, with the coefficients at the midpoints averaged between grid points
+  RK4_MIDPOINT,  // Runge-Kutta, with the potential at the midpoints
+  ADAMS_MOULTON6, // Implicit sixth order Adams-Moulton, started with RK4_MIDPOINT steps
+  DORMAND_PRINCE  // Adaptive fifth order Dormand-Prince, interpolated back on the grid
+};
 
 struct TurningPoint {
   int i;
   double Qi, Qe, Pi, Pe;
+  // d/dE (Q/P) at the turning point forward and backwards, if integrated
+  // along with Q and P (see shootDiracLog)
+  double zetai = NAN, zetae = NAN;
+};
+
+// Buffers for computing energy corrections (see DiracAtom::energyStep) and
+// for integrating several energies at once (see shootDiracLogBatch), kept by
+// the caller and reused between calls so that no memory is allocated once
+// they are large enough
+struct DiracWorkspace {
+  vector<double> y, zetai, zetae;
+  vector<double> AB, BA;
 };
 
-TurningPoint shootDiracLog(vector<double> &Q, vector<double> &P, vector<double> r, vector<double> V,
-                           double E, int k = -1, double m = 1, double dx = 1);
-void shootDiracErrorDELog(vector<double> &zeta, vector<double> y, vector<double> r, vector<double> V,
-                          int turn_i, double E, int k = -1, double m = 1, double dx = 1, char dir = 'f');
+TurningPoint shootDiracLog(vector<double> &Q, vector<double> &P, ArrayView r, ArrayView V,
+                           double E, int k = -1, double m = 1, double dx = 1, bool parallel = false,
+                           int nseg = 1, ArrayView Vmid = ArrayView(), DiracIntegrator method = RK4_AVERAGED,
+                           function<double(double)> Vfunc = nullptr, double tol = 1e-11,
+                           double zeta_e = NAN);
+vector<TurningPoint> shootDiracLogBatch(vector<vector<double>> &Q, vector<vector<double>> &P, ArrayView r,
+                                        ArrayView V, ArrayView E, const vector<pair<int, int>> &lims,
+                                        int k = -1, double m = 1, double dx = 1, DiracWorkspace *ws = NULL);
+double shootDiracPhaseLog(double QL, double PL, double QR, double PR, ArrayView r, ArrayView V,
+                          double E, int k = -1, double m = 1, double dx = 1);
+void shootDiracErrorDELog(vector<double> &zeta, ArrayView y, ArrayView r, ArrayView V,
+                          int turn_i, double E, int k = -1, double m = 1, double dx = 1, char dir = 'f',
+                          double y_turn = NAN);
 
 #endif
\ No newline at end of file
@@ -28,6 +28,9 @@ void writeDiracState(DiracState ds, string fname, int output_precision) {
   out << "#####################################################\n";
   out << "# DiracState with n = " << ds.getn() << ", l = " << ds.getl() << ", s = " << ds.gets() << "\n";
   out << "# E = " << ds.bindingE() / Physical::eV << " + mc^2 = " << ds.E / Physical::eV << " eV\n";
+  if (ds.E_err > 0) {
+    out << "# Estimated error on E = " << ds.E_err / Physical::eV << " eV\n";
+  }
   out << "# nodes = " << ds.nodes << ", " << ds.nodesQ << "\n";
   out << "#####################################################\n";
 
@@ -121,23 +124,47 @@ void writeEConfPotential(EConfPotential epot, string fname) {
  * @retval None
  */
 void writeSimSpec(vector<TransitionData> transitions, double dE, double lw, double expd, string fname) {
+  writeSimSpec(vector<vector<TransitionData>> {transitions}, vector<double> {1.0}, dE, lw, expd, fname);
+}
+
+/**
+ * @brief  Write a simulated spectrum for a mixture of isotopes
+ * @note   Same as the version for a single isotope, with the lines of each
+ * isotope weighted by its abundance.
+ *
+ * @param  transitions:         Transitions computed for each isotope
+ * @param  weights:             Abundance of each isotope
+ * @param  dE:                  Step of the points in the spectrum
+ * @param  lw:                  Line width for the Gaussians
+ * @param  expd:                Exponential decay factor
+ * @param  fname:               Name of the file to save
+ * @retval None
+ */
+void writeSimSpec(vector<vector<TransitionData>> transitions, vector<double> weights, double dE, double lw,
+                  double expd, string fname) {
   ofstream out(fname);
 
-  int N = transitions.size();
+  int N;
   double minE, maxE; // Looking for the boundaries
   vector<double> energies, intensities;
 
   minE = INFINITY;
   maxE = 0;
 
-  for (int i = 0; i < N; ++i) {
-    double E = (transitions[i].ds2.E - transitions[i].ds1.E) / Physical::eV;
-    minE = min(E, minE);
-    maxE = max(E, maxE);
+  for (int j = 0; j < (int)transitions.size(); ++j) {
+    if (weights[j] <= 0) {
+      continue;
+    }
+    for (int i = 0; i < (int)transitions[j].size(); ++i) {
+      double E = (transitions[j][i].ds2.E - transitions[j][i].ds1.E) / Physical::eV;
+      minE = min(E, minE);
+      maxE = max(E, maxE);
 
-    energies.push_back(E);
-    intensities.push_back(transitions[i].tmat.totalRate() * transitions[i].tmat.m1.size());
+      energies.push_back(E);
+      intensities.push_back(transitions[j][i].tmat.totalRate() * transitions[j][i].tmat.m1.size() * weights[j]);
+    }
   }
+  N = energies.size();
 
   // Now adjust the boundaries
   minE = max(0.0, minE - 5 * lw);
@@ -158,6 +185,148 @@ void writeSimSpec(vector<TransitionData> transitions, double dE, double lw, doub
   out.close();
 }
 
+/**
+ * @brief  Write a table of the shifts of spectral lines between isotopes
+ * @note   Write, for each visible line of the reference isotope and each
+ * isotope in which it was computed, the energy of the line and its shift
+ * with respect to the reference, in eV.
+ *
+ * @param  isotopes:         Mass numbers of the isotopes
+ * @param  transitions:      Transitions computed for each isotope
+ * @param  iref:             Index of the reference isotope
+ * @param  fname:            Filename
+ * @param  output_precision: Number of digits to print (default -1, maximum
+ * precision)
+ * @retval None
+ */
+void writeIsotopeShifts(vector<int> isotopes, vector<vector<TransitionData>> transitions, int iref, string fname,
+                        int output_precision) {
+  ofstream out(fname);
+
+  out << "# Line shifts with respect to A = " << isotopes[iref] << "\n";
+  out << "Line\tA\tDeltaE (eV)\tShift (eV)\n";
+  out << fixed;
+  out << setprecision(output_precision > -1 ? output_precision : 15);
+
+  for (int i = 0; i < (int)transitions[iref].size(); ++i) {
+    TransitionData &tref = transitions[iref][i];
+    double dEref = (tref.ds2.E - tref.ds1.E);
+    if (dEref <= 0 || tref.tmat.totalRate() <= 0)
+      continue; // Transition is invisible
+    for (int j = 0; j < (int)isotopes.size(); ++j) {
+      for (int t = 0; t < (int)transitions[j].size(); ++t) {
+        if (transitions[j][t].name != tref.name) {
+          continue;
+        }
+        double dE = (transitions[j][t].ds2.E - transitions[j][t].ds1.E);
+        out << tref.name << '\t' << isotopes[j] << '\t' << dE / Physical::eV << '\t' << (dE - dEref) / Physical::eV
+            << '\n';
+      }
+    }
+  }
+
+  out.close();
+}
+
+/**
+ * @brief  Write a table of the spectral lines of a mixture of isotopes
+ * @note   Write, for each isotope in the mixture and each of its visible
+ * lines, the energy of the line in eV and its transition rate weighted by
+ * the abundance of the isotope, so that the intensities of all the lines in
+ * the table can be compared.
+ *
+ * @param  isotopes:         Mass numbers of the isotopes
+ * @param  transitions:      Transitions computed for each isotope
+ * @param  weights:          Abundance of each isotope (0 for those not in
+ * the mixture)
+ * @param  fname:            Filename
+ * @param  output_precision: Number of digits to print (default -1, maximum
+ * precision)
+ * @retval None
+ */
+void writeIsotopeMixture(vector<int> isotopes, vector<vector<TransitionData>> transitions, vector<double> weights,
+                         string fname, int output_precision) {
+  ofstream out(fname);
+
+  out << "# Isotope mixture:";
+  for (int j = 0; j < (int)isotopes.size(); ++j) {
+    if (weights[j] > 0) {
+      out << " A = " << isotopes[j] << " (" << weights[j] << ")";
+    }
+  }
+  out << "\n";
+  out << "Line\tA\tDeltaE (eV)\tAbundance x W_12 (s^-1)\n";
+  out << fixed;
+  out << setprecision(output_precision > -1 ? output_precision : 15);
+
+  for (int j = 0; j < (int)isotopes.size(); ++j) {
+    if (weights[j] <= 0) {
+      continue;
+    }
+    for (int i = 0; i < (int)transitions[j].size(); ++i) {
+      double dE = (transitions[j][i].ds2.E - transitions[j][i].ds1.E);
+      double tRate = transitions[j][i].tmat.totalRate();
+      if (dE <= 0 || tRate <= 0)
+        continue; // Transition is invisible
+      out << transitions[j][i].name << '\t' << isotopes[j] << '\t' << dE / Physical::eV << '\t'
+          << weights[j] * tRate * Physical::s << '\n';
+    }
+  }
+
+  out.close();
+}
+
+/**
+ * @brief  Write a table of the spectral lines over a sweep of a parameter
+ * @note   Write, for each visible line and each value of the swept parameter
+ * at which it was computed, the energy of the line in eV. The nuclear radius
+ * and the Fermi 2-term thickness are written in fm.
+ *
+ * @param  param:            Name of the swept parameter
+ * @param  values:           Values of the parameter
+ * @param  transitions:      Transitions computed for each value
+ * @param  fname:            Filename
+ * @param  output_precision: Number of digits to print (default -1, maximum
+ * precision)
+ * @retval None
+ */
+void writeSweep(string param, vector<double> values, vector<vector<TransitionData>> transitions, string fname,
+                int output_precision) {
+  ofstream out(fname);
+
+  // All the visible lines, in the order in which they were found
+  vector<string> names;
+  for (int j = 0; j < (int)values.size(); ++j) {
+    for (int i = 0; i < (int)transitions[j].size(); ++i) {
+      double dE = (transitions[j][i].ds2.E - transitions[j][i].ds1.E);
+      if (dE <= 0 || transitions[j][i].tmat.totalRate() <= 0)
+        continue; // Transition is invisible
+      if (!vectorContains(names, transitions[j][i].name)) {
+        names.push_back(transitions[j][i].name);
+      }
+    }
+  }
+
+  out << "# Line energies over a sweep of " << param << "\n";
+  out << "Line\t" << param << (param == "LOGGRID_CENTER" ? "" : " (fm)") << "\tDeltaE (eV)\n";
+  out << fixed;
+  out << setprecision(output_precision > -1 ? output_precision : 15);
+
+  for (int k = 0; k < (int)names.size(); ++k) {
+    for (int j = 0; j < (int)values.size(); ++j) {
+      for (int i = 0; i < (int)transitions[j].size(); ++i) {
+        if (transitions[j][i].name != names[k]) {
+          continue;
+        }
+        double dE = (transitions[j][i].ds2.E - transitions[j][i].ds1.E);
+        out << names[k] << '\t' << values[j] << '\t' << dE / Physical::eV << '\n';
+      }
+    }
+  }
+
+  out.close();
+}
+
 // Debug tasks
 
 void writeEdEscan(vector<double> Es, vector<double> dEs, vector<int> nodes, string fname) {
@@ -169,4 +338,19 @@ void writeEdEscan(vector<double> Es, vector<double> dEs, vector<int> nodes, stri
   }
 
   out.close();
-}
\ No newline at end of file
+}
+
+void writeDxScan(vector<double> dxs, vector<int> npoints, vector<vector<double>> errs, string fname) {
+  ofstream out(fname);
+  int N = dxs.size();
+
+  for (int i = 0; i < N; ++i) {
+    out << dxs[i] << "\t" << npoints[i];
+    for (int j = 0; j < (int)errs.size(); ++j) {
+      out << "\t" << errs[j][i] / Physical::eV;
+    }
+    out << "\n";
+  }
+
+  out.close();
+}
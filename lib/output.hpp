@@ -27,8 +27,17 @@ void writeDiracState(DiracState ds, string fname, int output_precision=-1);
 void writeTransitionMatrix(TransitionMatrix tmat, string fname);
 void writeEConfPotential(EConfPotential epot, string fname);
 void writeSimSpec(vector<TransitionData> transitions, double dE, double lw, double expd, string fname);
+void writeSimSpec(vector<vector<TransitionData>> transitions, vector<double> weights, double dE, double lw,
+                  double expd, string fname);
+void writeIsotopeShifts(vector<int> isotopes, vector<vector<TransitionData>> transitions, int iref, string fname,
+                        int output_precision = -1);
+void writeIsotopeMixture(vector<int> isotopes, vector<vector<TransitionData>> transitions, vector<double> weights,
+                         string fname, int output_precision = -1);
+void writeSweep(string param, vector<double> values, vector<vector<TransitionData>> transitions, string fname,
+                int output_precision = -1);
 
 // Debug tasks
 void writeEdEscan(vector<double> Es, vector<double> dEs, vector<int> nodes, string fname="EdEscan.dat");
+void writeDxScan(vector<double> dxs, vector<int> npoints, vector<vector<double>> errs, string fname="dxscan.dat");
 
 #endif
@@ -32,7 +32,7 @@ CoulombSpherePotential::CoulombSpherePotential(double Z, double R) {
   this->VR = R > 0 ? -1.5 * Z / R : 0;
 }
 
-double CoulombSpherePotential::V(double r) {
+double CoulombSpherePotential::V(double r) const {
 
   if (r < 0) {
     throw invalid_argument("Negative radius not allowed for CoulombPotential");
@@ -101,7 +101,7 @@ CoulombFermi2Potential::CoulombFermi2Potential(double Z, double R, double A,
   VR = -Z / grid[1].back() - Vgrid.back();
 }
 
-double CoulombFermi2Potential::V(double r) {
+double CoulombFermi2Potential::V(double r) const {
 
   if (r < 0) {
     throw invalid_argument("Negative radius not allowed for CoulombPotential");
@@ -141,7 +141,6 @@ UehlingSpherePotential::UehlingSpherePotential(double Z, double R, int usteps) {
   this->R = R;
   this->usteps = usteps;
   du = 1.0 / (usteps - 1.0);
-  uarg = vector<double>(usteps, 0);
   uker = vector<double>(usteps, 0);
   u24c2 = vector<double>(usteps, 0);
   uker_great = vector<double>(usteps, 0);
@@ -161,7 +160,7 @@ UehlingSpherePotential::UehlingSpherePotential(double Z, double R, int usteps) {
   if (R > 0) {
     rho = Z * 0.75 / (M_PI * pow(R, 3));
     // Compute the 'uint0' term
-    uarg[0] = 0;
+    vector<double> uarg(usteps, 0);
     double eps = 0.5 * 1e-7 * du;
     for (int i = 1; i < usteps; ++i) {
       double u = i * du;
@@ -207,7 +206,7 @@ double UehlingSpherePotential::ukernel_r_greater(double u, double r, double R) {
  * @param  rR   If true, consider r = R
  * @retval Kernel value
  */
-double UehlingSpherePotential::ukernel_r_greater(int i, double r, bool rR) {
+double UehlingSpherePotential::ukernel_r_greater(int i, double r, bool rR) const {
   double ans;
   if (!rR) {
     ans = exp(-2 * r * Physical::c / (du * i));
@@ -250,7 +249,7 @@ double UehlingSpherePotential::ukernel_r_smaller(double u, double r, double R) {
  * @param  rR   If true, consider r = R
  * @retval Kernel value
  */
-double UehlingSpherePotential::ukernel_r_smaller(int i, double r, bool rR) {
+double UehlingSpherePotential::ukernel_r_smaller(int i, double r, bool rR) const {
   double ans;
   double u = du * i;
 
@@ -276,33 +275,213 @@ double UehlingSpherePotential::ukernel_point(double u, double r) {
   return 1 / u * exp(-2 * r * Physical::c / u);
 }
 
-double UehlingSpherePotential::V(double r) {
+/**
+ * @brief  Evaluate the Uehling potential at r
+ * @note   Evaluate the Uehling potential at r, either by numerical
+ * integration over u (using the exponential cutoffs, if set) or, if
+ * set_tabulated has been called, by interpolation from a precomputed table.
+ *
+ * @param  r:  Distance from the center at which to evaluate potential
+ * @retval     Potential
+ */
+double UehlingSpherePotential::V(double r) const {
+  if (tabulated) {
+    return Vtabulated(r);
+  }
+
   // Avoid all this mess if r is big enough
   if (r > exp_cutoff_high * 0.5 * Physical::alpha) {
     return 0.0;
   } else if (r <= exp_cutoff_low * 0.5 * du * Physical::alpha) {
     return K * uint0;
   }
-  // Fill in the u integration kernel
-  uarg[0] = 0;
+
+  return Vintegral(r);
+}
+
+/**
+ * @brief  Evaluate the Uehling potential at r by numerical integration
+ * @note   Evaluate the Uehling potential at r by numerical integration
+ * over u, with no approximations besides the finite number of steps.
+ *
+ * @param  r:  Distance from the center at which to evaluate potential
+ * @retval     Potential
+ */
+double UehlingSpherePotential::Vintegral(double r) const {
+  // Trapezoidal rule over u, summed directly so that V needs no buffer and
+  // is reentrant. The integrand vanishes at u = 0, so only the last point
+  // needs half weight
+  double ans = 0.0;
   for (int i = 1; i < usteps; ++i) {
     double u = i * du;
+    double uarg;
     if (R <= 0) {
-      uarg[i] = ukernel_point(u, r);
+      uarg = ukernel_point(u, r);
     } else if (r > R) {
-      uarg[i] = ukernel_r_greater(i, r);
+      uarg = ukernel_r_greater(i, r);
     } else {
-      uarg[i] = ukernel_r_greater(i, r, true) + ukernel_r_smaller(i, r) -
-                ukernel_r_smaller(i, r, true);
+      uarg = ukernel_r_greater(i, r, true) + ukernel_r_smaller(i, r) -
+             ukernel_r_smaller(i, r, true);
     }
 
-    uarg[i] *= uker[i];
+    ans += (i == usteps - 1 ? 0.5 : 1.0) * uarg * uker[i];
   }
-  double ans = trapzInt(du, uarg);
+  ans *= du;
 
   return K / r * ans;
 }
 
+/**
+ * @brief  Switch tabulated evaluation of the potential on or off
+ * @note   Switch tabulated evaluation of the potential on or off. When on,
+ * log(V/K) is computed once on a uniform grid in log(r) and V is then found
+ * by monotone cubic Hermite interpolation, a constant time operation. Outside
+ * of the table the known asymptotic forms are used, matched to the table at
+ * its ends:
+ *
+ * V ~ K*uint0 + c*r^2                (r -> 0, finite nucleus)
+ * V ~ K/r*(c - log(2rc))             (r -> 0, point-like nucleus)
+ * V ~ C*exp(-2rc)/(r*(2rc)^(3/2))*(1-29/(16rc))    (r -> infinity)
+ *
+ * The table replaces the exponential cutoffs, which are ignored while it is
+ * in use. The maximum relative error of the interpolation against the
+ * integral, measured halfway between table points, is stored and can be
+ * retrieved with get_table_error.
+ *
+ * @param  s:       Whether tabulated evaluation should be on/off
+ * @param  dlogr:   Step of the table in log(r) (default = 1e-2)
+ * @retval None
+ */
+void UehlingSpherePotential::set_tabulated(bool s, double dlogr) {
+  tabulated = false;
+  table_y.clear();
+  table_m.clear();
+  table_err = 0;
+
+  if (!s) {
+    return;
+  }
+  if (dlogr <= 0) {
+    throw invalid_argument("Invalid step for Uehling potential table");
+  }
+
+  // Range of the table, in units of half the electron Compton wavelength
+  double lam = 0.5 * Physical::alpha;
+  double r0 = (R > 0 ? min(R * 1e-3, lam * 1e-5) : lam * 1e-5);
+  double r1 = 40 * lam;
+
+  // For a finite nucleus, make sure r = R is a node, since the potential
+  // is not smooth there
+  int iR = -1;
+  if (R > 0) {
+    iR = ceil(log(R / r0) / dlogr);
+    r0 = R * exp(-iR * dlogr);
+  }
+  int N = ceil(log(r1 / r0) / dlogr) + 1;
+  table_lr0 = log(r0);
+  table_dlr = dlogr;
+  table_y = vector<double>(N);
+  table_m = vector<double>(N);
+
+  for (int i = 0; i < N; ++i) {
+    table_y[i] = log(Vintegral(exp(table_lr0 + i * dlogr)) / K);
+  }
+
+  // Slopes from fourth order finite differences, then limited as in
+  // Fritsch-Carlson to preserve monotonicity
+  vector<double> d(N - 1);
+  for (int i = 0; i < N - 1; ++i) {
+    d[i] = (table_y[i + 1] - table_y[i]) / dlogr;
+  }
+  table_m[0] = (-3 * table_y[0] + 4 * table_y[1] - table_y[2]) / (2 * dlogr);
+  table_m[N - 1] =
+    (3 * table_y[N - 1] - 4 * table_y[N - 2] + table_y[N - 3]) / (2 * dlogr);
+  for (int i = 1; i < N - 1; ++i) {
+    if (d[i - 1] * d[i] <= 0) {
+      table_m[i] = 0;
+    } else if (i == iR - 1 || i == iR) {
+      // Don't use points across r = R
+      table_m[i] =
+        (3 * table_y[i] - 4 * table_y[i - 1] + table_y[i - 2]) / (2 * dlogr);
+    } else if (i == iR + 1) {
+      table_m[i] =
+        (-3 * table_y[i] + 4 * table_y[i + 1] - table_y[i + 2]) / (2 * dlogr);
+    } else if (i < 2 || i > N - 3) {
+      table_m[i] = 0.5 * (d[i - 1] + d[i]);
+    } else {
+      table_m[i] = (table_y[i - 2] - 8 * table_y[i - 1] + 8 * table_y[i + 1] -
+                    table_y[i + 2]) /
+                   (12 * dlogr);
+    }
+  }
+  for (int i = 0; i < N - 1; ++i) {
+    if (d[i] == 0) {
+      table_m[i] = 0;
+      table_m[i + 1] = 0;
+      continue;
+    }
+    double a = table_m[i] / d[i], b = table_m[i + 1] / d[i];
+    double h = a * a + b * b;
+    if (h > 9) {
+      table_m[i] = 3 * a / sqrt(h) * d[i];
+      table_m[i + 1] = 3 * b / sqrt(h) * d[i];
+    }
+  }
+
+  // Match the asymptotic tails
+  r1 = exp(table_lr0 + (N - 1) * dlogr);
+  double V0 = K * exp(table_y[0]), V1 = K * exp(table_y[N - 1]);
+  if (R > 0) {
+    tail_low = (V0 - K * uint0) / pow(r0, 2);
+  } else {
+    tail_low = r0 * V0 / K + log(r0 / lam);
+  }
+  tail_high = V1 * r1 * exp(r1 / lam) * pow(r1 / lam, 1.5) /
+              (1 - 29.0 / 8.0 * lam / r1);
+
+  tabulated = true;
+
+  // Measure the error
+  for (int i = 0; i < N - 1; ++i) {
+    double r = exp(table_lr0 + (i + 0.5) * dlogr);
+    double Vi = Vintegral(r);
+    table_err = max(table_err, abs(Vtabulated(r) / Vi - 1));
+  }
+}
+
+/**
+ * @brief  Evaluate the Uehling potential at r from the table
+ *
+ * @param  r:  Distance from the center at which to evaluate potential
+ * @retval     Potential
+ */
+double UehlingSpherePotential::Vtabulated(double r) const {
+  int N = table_y.size();
+  double lam = 0.5 * Physical::alpha;
+  double t = (log(r) - table_lr0) / table_dlr;
+
+  if (t < 0) {
+    if (R > 0) {
+      return K * uint0 + tail_low * r * r;
+    } else {
+      return K / r * (tail_low - log(r / lam));
+    }
+  } else if (t >= N - 1) {
+    return tail_high * exp(-r / lam) / (r * pow(r / lam, 1.5)) *
+           (1 - 29.0 / 8.0 * lam / r);
+  }
+
+  int i = floor(t);
+  t -= i;
+  double t2 = t * t, t3 = t2 * t;
+  double y = (2 * t3 - 3 * t2 + 1) * table_y[i] +
+             (t3 - 2 * t2 + t) * table_dlr * table_m[i] +
+             (-2 * t3 + 3 * t2) * table_y[i + 1] +
+             (t3 - t2) * table_dlr * table_m[i + 1];
+
+  return K * exp(y);
+}
+
 BkgGridPotential::BkgGridPotential(vector<double> rho, double rc, double dx,
                                    int i0, int i1) {
   this->rc = rc;
@@ -339,7 +518,7 @@ void BkgGridPotential::initPotential(vector<double> rho) {
   V0 = -Q / grid[1][i1 - i0] - Vpot[i1 - i0];
 }
 
-double BkgGridPotential::V(double r) {
+double BkgGridPotential::V(double r) const {
   // Find the index
   double xi = log(r / rc) / dx;
 
@@ -42,7 +42,7 @@ class Potential {
    * @param  r:  Distance from the center at which to evaluate potential
    * @retval     Potential
    */
-  virtual double V(double r) {
+  virtual double V(double r) const {
     return 0;
   };
 };
@@ -56,7 +56,7 @@ class Potential {
 class CoulombSpherePotential : Potential {
  public:
   CoulombSpherePotential(double Z = 1.0, double R = -1);
-  virtual double V(double r) override;
+  virtual double V(double r) const override;
 
  protected:
   double R, R3, VR, Z;
@@ -74,7 +74,7 @@ class CoulombFermi2Potential : public CoulombSpherePotential {
  public:
   CoulombFermi2Potential(double Z = 1.0, double R = -1, double A = 1.0,
                          double thickness = Physical::fermi2_T, int csteps = 5000);
-  virtual double V(double r) override;
+  virtual double V(double r) const override;
 
   double getc() {
     return c;
@@ -97,18 +97,28 @@ class CoulombFermi2Potential : public CoulombSpherePotential {
 class UehlingSpherePotential : Potential {
  public:
   UehlingSpherePotential(double Z = 1.0, double R = -1, int usteps = 100);
-  double V(double r) override;
+  double V(double r) const override;
+  double Vintegral(double r) const;
 
   void set_exp_cutoffs(double low, double high) {
     exp_cutoff_low = low;
     exp_cutoff_high = high;
   };
 
+  // Tabulated evaluation
+  void set_tabulated(bool s, double dlogr = 1e-2);
+  bool get_tabulated() const {
+    return tabulated;
+  };
+  double get_table_error() const {
+    return table_err;
+  };
+
   static double ukernel_r_greater(double u, double r, double R);
-  double ukernel_r_greater(int i, double r, bool rR = false);
+  double ukernel_r_greater(int i, double r, bool rR = false) const;
 
   static double ukernel_r_smaller(double u, double r, double R);
-  double ukernel_r_smaller(int i, double r, bool rR = false);
+  double ukernel_r_smaller(int i, double r, bool rR = false) const;
 
   static double ukernel_r_verysmall(double u, double R);
   static double ukernel_point(double u, double r);
@@ -120,7 +130,16 @@ class UehlingSpherePotential : Potential {
     0.0; // Cutoff point x under which we approximate exp(-x) = 1
   double Z, R, rho, K, V0, du, uint0;
   int usteps;
-  vector<double> uarg, uker, u24c2, uker_great, uker_small;
+  vector<double> uker, u24c2, uker_great, uker_small;
+
+  // Table of log(V/K) on a uniform grid in log(r), with the slopes used for
+  // monotone cubic Hermite interpolation, and matched asymptotic tails
+  bool tabulated = false;
+  double table_lr0, table_dlr, table_err = 0;
+  vector<double> table_y, table_m;
+  double tail_low, tail_high;
+
+  double Vtabulated(double r) const;
 };
 
 /**
@@ -134,7 +153,7 @@ class BkgGridPotential : Potential {
  public:
   BkgGridPotential();
   BkgGridPotential(vector<double> rho, double rc, double dx, int i0, int i1);
-  double V(double r) override;
+  double V(double r) const override;
   double Vgrid(int i);
 
   double getQ() {
@@ -75,9 +75,9 @@ void SchroState::resize(int i0, int i1) {
   int d0 = i0 - grid_indices.first;
   int d1 = grid_indices.second - i1;
 
-  grid = vector<double>(grid.begin() + d0, grid.end() - d1);
-  loggrid = vector<double>(loggrid.begin() + d0, loggrid.end() - d1);
-  V = vector<double>(V.begin() + d0, V.end() - d1);
+  grid = grid.slice(d0, grid.size() - d1);
+  loggrid = loggrid.slice(d0, loggrid.size() - d1);
+  V = V.slice(d0, V.size() - d1);
   R = vector<double>(R.begin() + d0, R.end() - d1);
 
   grid_indices.first = i0;
@@ -92,11 +92,12 @@ void SchroState::resize(int i0, int i1) {
  * @retval
  */
 DiracState::DiracState(int N) {
-  grid = vector<double>(N, 0);
-  loggrid = vector<double>(N, 0);
-  Q = vector<double>(N, 0);
-  P = vector<double>(N, 0);
-  V = vector<double>(N, 0);
+  vector<double> zeros(N, 0);
+  grid = zeros;
+  loggrid = grid;
+  V = grid;
+  Q = zeros;
+  P = zeros;
 }
 
 /**
@@ -139,14 +140,16 @@ DiracState::DiracState(const DiracState &s) {
   nodes = s.nodes;
   nodesQ = s.nodesQ;
   E = s.E;
+  E_err = s.E_err;
   k = s.k;
   m = s.m;
   grid_indices = pair<int, int>(s.grid_indices);
-  grid = vector<double>(s.grid);
-  loggrid = vector<double>(s.loggrid);
+  // The grid and potential are shared, only the wavefunction is copied
+  grid = s.grid;
+  loggrid = s.loggrid;
   Q = vector<double>(s.Q);
   P = vector<double>(s.P);
-  V = vector<double>(s.V);
+  V = s.V;
 }
 
 /**
@@ -189,9 +192,9 @@ void DiracState::resize(int i0, int i1) {
   int d0 = i0 - grid_indices.first;
   int d1 = grid_indices.second - i1;
 
-  grid = vector<double>(grid.begin() + d0, grid.end() - d1);
-  loggrid = vector<double>(loggrid.begin() + d0, loggrid.end() - d1);
-  V = vector<double>(V.begin() + d0, V.end() - d1);
+  grid = grid.slice(d0, grid.size() - d1);
+  loggrid = loggrid.slice(d0, loggrid.size() - d1);
+  V = V.slice(d0, V.size() - d1);
   Q = vector<double>(Q.begin() + d0, Q.end() - d1);
   P = vector<double>(P.begin() + d0, P.end() - d1);
 
@@ -307,4 +310,87 @@ double DiracState::bindingE() {
  */
 string DiracState::name() {
   return printIupacState(getn(), getl(), gets());
+}
+
+// Helpers for binary (de)serialisation
+template <typename T>
+static void writeBinary(ostream &out, T v) {
+  out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template <typename T>
+static T readBinary(istream &in) {
+  T v;
+  in.read(reinterpret_cast<char *>(&v), sizeof(T));
+  return v;
+}
+
+static void writeBinaryVector(ostream &out, ArrayView v) {
+  writeBinary<int>(out, v.size());
+  out.write(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(double));
+}
+
+static vector<double> readBinaryVector(istream &in) {
+  int N = readBinary<int>(in);
+  if (!in || N < 0) {
+    throw runtime_error("Invalid vector size in binary DiracState");
+  }
+  vector<double> v(N);
+  in.read(reinterpret_cast<char *>(v.data()), N * sizeof(double));
+  return v;
+}
+
+/**
+ * @brief  Write the state to a binary stream
+ * @note   Write the full state (quantum numbers, energy, grid, potential and
+ * wavefunction) to a binary stream, in a format that can be read back with
+ * load. The format is not meant to be portable across machines.
+ *
+ * @param  &out:    Output stream
+ * @retval None
+ */
+void DiracState::save(ostream &out) {
+  writeBinary<char>(out, converged);
+  writeBinary<int>(out, nodes);
+  writeBinary<int>(out, nodesQ);
+  writeBinary<int>(out, k);
+  writeBinary<double>(out, E);
+  writeBinary<double>(out, E_err);
+  writeBinary<double>(out, m);
+  writeBinary<int>(out, grid_indices.first);
+  writeBinary<int>(out, grid_indices.second);
+  writeBinaryVector(out, grid);
+  writeBinaryVector(out, loggrid);
+  writeBinaryVector(out, V);
+  writeBinaryVector(out, Q);
+  writeBinaryVector(out, P);
+}
+
+/**
+ * @brief  Read the state from a binary stream
+ * @note   Read a state written by save from a binary stream, replacing
+ * the current contents of this one.
+ *
+ * @param  &in:     Input stream
+ * @retval None
+ */
+void DiracState::load(istream &in) {
+  converged = readBinary<char>(in);
+  nodes = readBinary<int>(in);
+  nodesQ = readBinary<int>(in);
+  k = readBinary<int>(in);
+  E = readBinary<double>(in);
+  E_err = readBinary<double>(in);
+  m = readBinary<double>(in);
+  grid_indices.first = readBinary<int>(in);
+  grid_indices.second = readBinary<int>(in);
+  grid = readBinaryVector(in);
+  loggrid = readBinaryVector(in);
+  V = readBinaryVector(in);
+  Q = readBinaryVector(in);
+  P = readBinaryVector(in);
+
+  if (!in) {
+    throw runtime_error("Could not read DiracState from binary stream");
+  }
 }
\ No newline at end of file
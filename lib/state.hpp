@@ -11,6 +11,7 @@
  */
 
 #include<vector>
+#include<iostream>
 #include "integrate.hpp"
 
 using namespace std;
@@ -23,10 +24,13 @@ class State {
   bool converged = false; // Used to flag states that are "good" to use
   int nodes = 0;
   double E = 0;
+  double E_err = 0; // Estimated error on E, if known (see DiracAtom::extrapolateState)
   pair<int, int> grid_indices;
-  vector<double> grid;
-  vector<double> loggrid;
-  vector<double> V;
+  // Grid, logarithm of the grid and potential; usually slices of arrays
+  // shared with the atom and all its other states
+  SharedSlice grid;
+  SharedSlice loggrid;
+  SharedSlice V;
 
   State();
 
@@ -80,5 +84,8 @@ class DiracState : public State {
   void continuify(TurningPoint tp);
   void findNodes(double tol = 1e-6);
   void normalize();
+
+  void save(ostream &out);
+  void load(istream &in);
 };
 #endif
\ No newline at end of file
@@ -507,6 +507,26 @@ string upperString(string s) {
   return s2;
 }
 
+/**
+ * @brief  Hash a string
+ * @note   Compute the 64-bit FNV-1a hash of a string. Unlike std::hash, the
+ * result is guaranteed to be the same across runs and compilers, so it can be
+ * used to name files.
+ *
+ * @param  s:   String to hash
+ * @retval      Hash value
+ */
+unsigned long long hashString(string s) {
+  unsigned long long h = 14695981039346656037ULL;
+
+  for (int i = 0; i < (int)s.size(); ++i) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ULL;
+  }
+
+  return h;
+}
+
 /**
  * @brief Write a generic tabulated file with two columns
  * @note Write a generic tabulated file with two columns of data. Used mostly
@@ -16,6 +16,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <functional>
+#include <memory>
 
 #include "../vendor/aixlog/aixlog.hpp"
 
@@ -24,6 +25,94 @@ using namespace std;
 #ifndef MUDIRAC_UTILS
 #define MUDIRAC_UTILS
 
+/**
+ * @class ArrayView
+ *
+ * @brief  A read-only view on a contiguous range of doubles
+ * @note   A read-only view on a contiguous range of doubles owned by someone
+ * else, such as a vector or a part of it. Vectors convert to it implicitly,
+ * so functions that only read an array can take an ArrayView without copying
+ * it, and without their callers having to change. The view must not outlive
+ * the data it refers to.
+ */
+class ArrayView {
+ private:
+  const double *ptr;
+  int n;
+
+ public:
+  ArrayView(const double *ptr = NULL, int n = 0) : ptr(ptr), n(n) {};
+  ArrayView(const vector<double> &v) : ptr(v.data()), n(v.size()) {};
+
+  int size() const {
+    return n;
+  };
+  const double *data() const {
+    return ptr;
+  };
+  const double &operator[](int i) const {
+    return ptr[i];
+  };
+  const double *begin() const {
+    return ptr;
+  };
+  const double *end() const {
+    return ptr + n;
+  };
+  ArrayView slice(int i0, int i1) const {
+    return ArrayView(ptr + i0, i1 - i0);
+  };
+  vector<double> toVector() const {
+    return vector<double>(ptr, ptr + n);
+  };
+};
+
+/**
+ * @class SharedSlice
+ *
+ * @brief  A read-only range of an array whose storage is shared
+ * @note   A read-only range of an array held by a reference counted pointer,
+ * so that many objects can use parts of the same array (for example, the
+ * logarithmic grid of an atom) without each storing a copy. Copying a slice
+ * only copies the pointer. The array itself must never be modified once
+ * shared; anything that needs to change it must make a new one. Assigning a
+ * vector makes the slice span a new, unshared copy of it.
+ */
+class SharedSlice {
+ private:
+  shared_ptr<const vector<double>> arr;
+  int i0, n;
+
+ public:
+  SharedSlice() : i0(0), n(0) {};
+  SharedSlice(const vector<double> &v)
+    : arr(make_shared<const vector<double>>(v)), i0(0), n(v.size()) {};
+  SharedSlice(shared_ptr<const vector<double>> arr, int i0, int n)
+    : arr(arr), i0(i0), n(n) {};
+
+  int size() const {
+    return n;
+  };
+  const double &operator[](int i) const {
+    return (*arr)[i0 + i];
+  };
+  const double *begin() const {
+    return (n > 0) ? arr->data() + i0 : NULL;
+  };
+  const double *end() const {
+    return begin() + n;
+  };
+  SharedSlice slice(int j0, int j1) const {
+    return SharedSlice(arr, i0 + j0, j1 - j0);
+  };
+  operator ArrayView() const {
+    return ArrayView(begin(), n);
+  };
+  operator vector<double>() const {
+    return vector<double>(begin(), end());
+  };
+};
+
 double effectiveMass(double m1, double m2);
 
 int factorial(int n);
@@ -58,6 +147,7 @@ void parseIupacRange(string irange, vector<int> &nrange, vector<int> &lrange, ve
 vector<string> splitString(string s, string sep = " ", bool merge = false, int maxn = -1);
 string stripString(string s, string strip = " \t\n");
 string upperString(string s);
+unsigned long long hashString(string s);
 
 // Functions useful for debugging
 void writeTabulated2ColFile(vector<double> col1, vector<double> col2, string fname);
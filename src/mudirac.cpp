@@ -12,6 +12,238 @@
 
 #include "mudirac.hpp"
 
+/**
+ * @brief  Compute a list of spectral lines
+ * @note   Converge all the states needed for the given lines, as series
+ * sharing the same k and in parallel if required, then compute the energy
+ * and transition probabilities of each line. Lines involving states that
+ * failed to converge are logged and skipped.
+ *
+ * @param  &da:         Atom to compute the lines for
+ * @param  transqnums:  Quantum numbers of the lines
+ * @retval              Computed transitions
+ */
+vector<TransitionData> computeTransitions(DiracAtom &da, vector<TransLineSpec> transqnums) {
+  // Converge all the required states up front, as series sharing the same k
+  // and in parallel if requested
+  {
+    vector<tuple<int, int, bool>> qnums;
+    for (int i = 0; i < (int)transqnums.size(); ++i) {
+      qnums.push_back(make_tuple(transqnums[i].n1, transqnums[i].l1, transqnums[i].s1));
+      qnums.push_back(make_tuple(transqnums[i].n2, transqnums[i].l2, transqnums[i].s2));
+    }
+    da.calcStates(qnums);
+  }
+
+  vector<string> failconv_states; // Store states whose convergence has failed already, so we don't bother any more
+  vector<TransitionData> transitions;
+
+  for (int i = 0; i < (int)transqnums.size(); ++i) {
+    int n1, l1, n2, l2;
+    bool s1, s2;
+    bool success = true;
+    TransitionData tdata;
+
+    n1 = transqnums[i].n1;
+    l1 = transqnums[i].l1;
+    s1 = transqnums[i].s1;
+    n2 = transqnums[i].n2;
+    l2 = transqnums[i].l2;
+    s2 = transqnums[i].s2;
+
+    tdata.sname1 = printIupacState(n1, l1, s1);
+    tdata.sname2 = printIupacState(n2, l2, s2);
+    tdata.name = tdata.sname1 + "-" + tdata.sname2;
+
+    // Have these been tried before?
+    if (vectorContains(failconv_states, tdata.sname1)) {
+      LOG(INFO) << "Skipping line " << tdata.name << " because " << tdata.sname1 << " failed to converge before\n";
+      continue;
+    }
+    if (vectorContains(failconv_states, tdata.sname2)) {
+      LOG(INFO) << "Skipping line " << tdata.name << " because " << tdata.sname2 << " failed to converge before\n";
+      continue;
+    }
+
+    LOG(INFO) << "Computing transition " << tdata.name << "\n";
+
+    try {
+      LOG(INFO) << "Computing state " << tdata.sname1 << "\n";
+      tdata.ds1 = da.getState(n1, l1, s1);
+      LOG(INFO) << "Computing state " << tdata.sname2 << "\n";
+      tdata.ds2 = da.getState(n2, l2, s2);
+    } catch (AtomErrorCode aerr) {
+      LOG(ERROR) << SPECIAL << "Transition energy calculation for line " << tdata.name << " failed with AtomErrorCode " << aerr << "\n";
+      success = false;
+    } catch (const exception &e) {
+      LOG(ERROR) << SPECIAL << "Unknown error: " << e.what() << "\n";
+      success = false;
+    }
+    if (!success) {
+      LOG(INFO) << "Convergence of one state failed for line " << tdata.name << ", skipping\n";
+      if (!tdata.ds1.converged) {
+        failconv_states.push_back(tdata.sname1);
+      } else {
+        failconv_states.push_back(tdata.sname2);
+      }
+      continue;
+    }
+
+    // Compute transition probability
+    tdata.tmat = da.getTransitionProbabilities(n2, l2, s2, n1, l1, s1);
+
+    LOG(INFO) << "Transition energy = " << (tdata.ds2.E - tdata.ds1.E) / (Physical::eV * 1000) << " kEv\n";
+
+    transitions.push_back(tdata);
+  }
+
+  return transitions;
+}
+
+/**
+ * @brief  Compute a list of spectral lines for other isotopes
+ * @note   Compute the same lines as for a reference atom for other isotopes
+ * of the same element, each set up from the same configuration. The states
+ * of each isotope are warm started from those of the reference, which must
+ * already be converged, and the isotopes are computed in parallel, splitting
+ * the threads of the reference atom among them. Isotopes that can not be set
+ * up are logged and get no lines.
+ *
+ * @param  &config:     Input configuration
+ * @param  &da_ref:     Reference atom
+ * @param  isotopes:    Mass numbers of the isotopes
+ * @param  transqnums:  Quantum numbers of the lines
+ * @retval              Computed transitions, for each isotope
+ */
+vector<vector<TransitionData>> computeIsotopeTransitions(MuDiracInputFile &config, DiracAtom &da_ref, vector<int> isotopes,
+                                                         vector<TransLineSpec> transqnums) {
+  vector<vector<TransitionData>> transitions(isotopes.size());
+  vector<MuDiracInputFile> configs(isotopes.size(), config); // One per isotope, so threads never share one
+  atomic<int> next_iso(0);
+  int nt = max(1, min(da_ref.nthreads, (int)isotopes.size()));
+
+  auto worker = [&]() {
+    int i;
+    while ((i = next_iso++) < (int)isotopes.size()) {
+      LOG(INFO) << "Computing lines for isotope A = " << isotopes[i] << "\n";
+      try {
+        DiracAtom da = configs[i].makeAtom(isotopes[i]);
+        da.nthreads = max(1, da_ref.nthreads / nt);
+        da.warmStart(da_ref);
+        transitions[i] = computeTransitions(da, transqnums);
+        da.saveStateCache();
+      } catch (const exception &e) {
+        LOG(ERROR) << SPECIAL << "Calculation for isotope A = " << isotopes[i] << " failed: " << e.what() << "\n";
+      }
+    }
+  };
+
+  if (nt == 1) {
+    worker();
+    return transitions;
+  }
+
+  vector<thread> pool;
+  for (int i = 0; i < nt; ++i) {
+    pool.push_back(thread(worker));
+  }
+  for (int i = 0; i < nt; ++i) {
+    pool[i].join();
+  }
+
+  return transitions;
+}
+
+/**
+ * @brief  Set the value of a swept parameter on an atom
+ * @note   Set the value of the nuclear radius (RADIUS, in fm), of the
+ * thickness of the Fermi 2-term nucleus (FERMI2_T, in fm) or of the centre of
+ * the grid (LOGGRID_CENTER, as a fraction of the same radius as the
+ * loggrid_center keyword) of an atom. When the radius changes the centre of
+ * the grid is moved with it as it would be for a new atom, so that each point
+ * gives the same states as a separate calculation. The states converged so
+ * far are kept as warm starts.
+ *
+ * @param  &da:      Atom to modify
+ * @param  param:    Name of the parameter
+ * @param  value:    Value of the parameter
+ * @param  fc:       Centre of the grid (as for loggrid_center)
+ * @retval None
+ */
+void setSweepParameter(DiracAtom &da, string param, double value, double fc) {
+  if (param == "RADIUS") {
+    double R = value * Physical::fm;
+    da.setRadius(R, fc * max(1.0 / (da.getZ() * da.getmu()), R));
+  } else if (param == "FERMI2_T") {
+    da.setFermi2(value * Physical::fm);
+  } else if (param == "LOGGRID_CENTER") {
+    if (value <= 0) {
+      throw invalid_argument("Invalid grid parameters passed to Atom");
+    }
+    da.setgrid(value * max(1.0 / (da.getZ() * da.getmu()), da.getR()), da.getdx());
+  } else {
+    throw invalid_argument("Invalid sweep_param parameter in input file");
+  }
+}
+
+/**
+ * @brief  Compute a list of spectral lines over a sweep of a parameter
+ * @note   Compute the same lines as for a reference atom for a series of
+ * values of one of its parameters (see setSweepParameter). The values are
+ * split in as many contiguous runs as there are threads, each computed by
+ * its own atom, and walked in order: the states of each point are warm
+ * started from those of the previous one, and those of the first point of
+ * each run from the reference atom, which must already be converged. Points
+ * that fail are logged and get no lines.
+ *
+ * @param  &config:     Input configuration
+ * @param  &da_ref:     Reference atom
+ * @param  param:       Name of the swept parameter
+ * @param  values:      Values of the parameter
+ * @param  transqnums:  Quantum numbers of the lines
+ * @retval              Computed transitions, for each value
+ */
+vector<vector<TransitionData>> computeSweepTransitions(MuDiracInputFile &config, DiracAtom &da_ref, string param,
+                                                       vector<double> values, vector<TransLineSpec> transqnums) {
+  vector<vector<TransitionData>> transitions(values.size());
+  int nt = max(1, min(da_ref.nthreads, (int)values.size()));
+  vector<MuDiracInputFile> configs(nt, config); // One per thread
+  double fc = config.getDoubleValue("loggrid_center");
+
+  auto worker = [&](int t) {
+    int i0 = values.size() * t / nt;
+    int i1 = values.size() * (t + 1) / nt;
+    DiracAtom da = configs[t].makeAtom(da_ref.getA());
+    da.nthreads = max(1, da_ref.nthreads / nt);
+    da.warmStart(da_ref);
+    for (int i = i0; i < i1; ++i) {
+      LOG(INFO) << "Computing lines for " << param << " = " << values[i] << "\n";
+      try {
+        setSweepParameter(da, param, values[i], fc);
+        transitions[i] = computeTransitions(da, transqnums);
+        da.saveStateCache();
+      } catch (const exception &e) {
+        LOG(ERROR) << SPECIAL << "Calculation for " << param << " = " << values[i] << " failed: " << e.what() << "\n";
+      }
+    }
+  };
+
+  if (nt == 1) {
+    worker(0);
+    return transitions;
+  }
+
+  vector<thread> pool;
+  for (int t = 0; t < nt; ++t) {
+    pool.push_back(thread(worker, t));
+  }
+  for (int t = 0; t < nt; ++t) {
+    pool[t].join();
+  }
+
+  return transitions;
+}
+
 int main(int argc, char *argv[]) {
   string seed = "mudirac";
   MuDiracInputFile config;
@@ -73,6 +305,11 @@ int main(int argc, char *argv[]) {
     runEdEscan(config);
     return 0;
   }
+  if (debugtask == "dxscan") {
+    LOG(INFO) << "Running debug task: grid step scan\n";
+    runDxScan(config);
+    return 0;
+  }
 
   DiracAtom da = config.makeAtom();
 
@@ -133,66 +370,93 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  vector<string> failconv_states; // Store states whose convergence has failed already, so we don't bother any more
-  vector<TransitionData> transitions;
-
-  for (int i = 0; i < transqnums.size(); ++i) {
-    int n1, l1, n2, l2;
-    bool s1, s2;
-    bool success = true;
-    TransitionData tdata;
-
-    n1 = transqnums[i].n1;
-    l1 = transqnums[i].l1;
-    s1 = transqnums[i].s1;
-    n2 = transqnums[i].n2;
-    l2 = transqnums[i].l2;
-    s2 = transqnums[i].s2;
-
-    tdata.sname1 = printIupacState(n1, l1, s1);
-    tdata.sname2 = printIupacState(n2, l2, s2);
-    tdata.name = tdata.sname1 + "-" + tdata.sname2;
-
-    // Have these been tried before?
-    if (vectorContains(failconv_states, tdata.sname1)) {
-      LOG(INFO) << "Skipping line " << tdata.name << " because " << tdata.sname1 << " failed to converge before\n";
-      continue;
+  vector<TransitionData> transitions = computeTransitions(da, transqnums);
+
+  // Store the converged states for future runs
+  da.saveStateCache();
+
+  // Compute the same lines for other isotopes, if requested
+  vector<string> isoshift = config.getStringValues("isotope_shift");
+  vector<string> isomix = config.getStringValues("isotope_mixture");
+  vector<int> isotopes;
+  vector<vector<TransitionData>> isotope_transitions;
+  map<int, double> abundances;
+  int iref = 0;
+  if (isoshift.size() == 1 && isoshift[0] == "ALL") {
+    isotopes = getAllIsotopes(da.getZ());
+  } else {
+    for (int i = 0; i < (int)isoshift.size(); ++i) {
+      try {
+        isotopes.push_back(stoi(isoshift[i]));
+      } catch (const exception &e) {
+        throw invalid_argument("Invalid isotope_shift parameter in input file");
+      }
     }
-    if (vectorContains(failconv_states, tdata.sname2)) {
-      LOG(INFO) << "Skipping line " << tdata.name << " because " << tdata.sname2 << " failed to converge before\n";
-      continue;
+  }
+  if (isomix.size() > 0) {
+    double total = 0;
+    for (int i = 0; i < (int)isomix.size(); ++i) {
+      vector<string> parts = splitString(isomix[i], ":");
+      try {
+        if (parts.size() != 2 || stod(parts[1]) < 0) {
+          throw invalid_argument("");
+        }
+        abundances[stoi(parts[0])] += stod(parts[1]);
+        total += stod(parts[1]);
+      } catch (const exception &e) {
+        throw invalid_argument("Invalid isotope_mixture parameter in input file");
+      }
     }
-
-    LOG(INFO) << "Computing transition " << tdata.name << "\n";
-
-    try {
-      LOG(INFO) << "Computing state " << tdata.sname1 << "\n";
-      tdata.ds1 = da.getState(n1, l1, s1);
-      LOG(INFO) << "Computing state " << tdata.sname2 << "\n";
-      tdata.ds2 = da.getState(n2, l2, s2);
-    } catch (AtomErrorCode aerr) {
-      LOG(ERROR) << SPECIAL << "Transition energy calculation for line " << tdata.name << " failed with AtomErrorCode " << aerr << "\n";
-      success = false;
-    } catch (const exception &e) {
-      LOG(ERROR) << SPECIAL << "Unknown error: " << e.what() << "\n";
-      success = false;
+    if (total <= 0) {
+      throw invalid_argument("Invalid isotope_mixture parameter in input file");
     }
-    if (!success) {
-      LOG(INFO) << "Convergence of one state failed for line " << tdata.name << ", skipping\n";
-      if (!tdata.ds1.converged) {
-        failconv_states.push_back(tdata.sname1);
+    double mintol = config.getDoubleValue("isotope_mixture_min");
+    for (auto it = abundances.begin(); it != abundances.end();) {
+      it->second /= total;
+      if (it->second < mintol || it->second == 0) {
+        LOG(INFO) << "Isotope A = " << it->first << " below the abundance threshold, skipping\n";
+        it = abundances.erase(it);
       } else {
-        failconv_states.push_back(tdata.sname2);
+        isotopes.push_back(it->first);
+        ++it;
       }
-      continue;
     }
+  }
+  if (isotopes.size() > 0) {
+    if (!vectorContains(isotopes, (int)da.getA())) {
+      isotopes.push_back(da.getA());
+    }
+    sort(isotopes.begin(), isotopes.end());
+    isotopes.erase(unique(isotopes.begin(), isotopes.end()), isotopes.end());
 
-    // Compute transition probability
-    tdata.tmat = da.getTransitionProbabilities(n2, l2, s2, n1, l1, s1);
-
-    LOG(INFO) << "Transition energy = " << (tdata.ds2.E - tdata.ds1.E) / (Physical::eV * 1000) << " kEv\n";
+    vector<int> others;
+    for (int i = 0; i < (int)isotopes.size(); ++i) {
+      if (isotopes[i] == da.getA()) {
+        iref = i;
+      } else {
+        others.push_back(isotopes[i]);
+      }
+    }
+    LOG(INFO) << "Computing lines for " << others.size() << " other isotopes\n";
+    isotope_transitions = computeIsotopeTransitions(config, da, others, transqnums);
+    isotope_transitions.insert(isotope_transitions.begin() + iref, transitions);
+  }
 
-    transitions.push_back(tdata);
+  // Compute the same lines over a sweep of a parameter, if requested
+  string sweep_param = config.getStringValue("sweep_param");
+  vector<double> sweep_values = config.getDoubleValues("sweep_values");
+  vector<vector<TransitionData>> sweep_transitions;
+  if (sweep_param != "") {
+    if (sweep_param != "RADIUS" && sweep_param != "FERMI2_T" && sweep_param != "LOGGRID_CENTER") {
+      throw invalid_argument("Invalid sweep_param parameter in input file");
+    }
+    if ((sweep_param == "RADIUS" && config.getStringValue("nuclear_model") == "POINT") ||
+        (sweep_param == "FERMI2_T" && config.getStringValue("nuclear_model") != "FERMI2")) {
+      throw invalid_argument("sweep_param " + sweep_param + " can not be used with nuclear_model " +
+                             config.getStringValue("nuclear_model"));
+    }
+    LOG(INFO) << "Computing lines for " << sweep_values.size() << " values of " << sweep_param << "\n";
+    sweep_transitions = computeSweepTransitions(config, da, sweep_param, sweep_values, transqnums);
   }
 
   // Sort transitions by energy if requested
@@ -209,7 +473,10 @@ int main(int argc, char *argv[]) {
     ofstream out(seed + ".xr.out");
 
     out << "# Z = " << da.getZ() << ", A = " << da.getA() << " amu, m = " << da.getm() << " au\n";
-    out << "Line\tDeltaE (eV)\tW_12 (s^-1)\n";
+    bool print_err = (da.richardson_levels > 1 || da.getTargetAccuracy() > 0 ||
+                      (da.getCorrectionMode() == PERTURBATIVE_CORRECTIONS && da.perturbative_tol > 0 &&
+                       da.getPotentialFlags() > 0));
+    out << "Line\tDeltaE (eV)\tW_12 (s^-1)" << (print_err ? "\tDeltaE error (eV)" : "") << "\n";
     out << fixed;
 
     if (config.getIntValue("xr_print_precision") > -1) {
@@ -224,16 +491,47 @@ int main(int argc, char *argv[]) {
       if (dE <= 0 || tRate <= 0)
         continue; // Transition is invisible
       out << transitions[i].name << '\t' << dE / Physical::eV;
-      out << "\t\t" << tRate * Physical::s << '\n';
+      out << "\t\t" << tRate * Physical::s;
+      if (print_err) {
+        // Errors are not assumed to cancel out
+        out << '\t' << (transitions[i].ds1.E_err + transitions[i].ds2.E_err) / Physical::eV;
+      }
+      out << '\n';
+    }
+
+    // Weights of the isotopes in the mixture, if any
+    vector<double> weights(isotopes.size(), 0.0);
+    for (int i = 0; i < (int)isotopes.size(); ++i) {
+      if (abundances.find(isotopes[i]) != abundances.end()) {
+        weights[i] = abundances[isotopes[i]];
+      }
     }
 
     if (config.getBoolValue("write_spec")) {
       // Write a spectrum
-      writeSimSpec(transitions, config.getDoubleValue("spec_step"), config.getDoubleValue("spec_linewidth"), config.getDoubleValue("spec_expdec"),
-                   seed + ".spec.dat");
+      if (abundances.size() > 0) {
+        writeSimSpec(isotope_transitions, weights, config.getDoubleValue("spec_step"),
+                     config.getDoubleValue("spec_linewidth"), config.getDoubleValue("spec_expdec"), seed + ".spec.dat");
+      } else {
+        writeSimSpec(transitions, config.getDoubleValue("spec_step"), config.getDoubleValue("spec_linewidth"),
+                     config.getDoubleValue("spec_expdec"), seed + ".spec.dat");
+      }
     }
 
     out.close();
+
+    if (isoshift.size() > 0) {
+      writeIsotopeShifts(isotopes, isotope_transitions, iref, seed + ".isoshift.out",
+                         config.getIntValue("xr_print_precision"));
+    }
+    if (sweep_param != "") {
+      writeSweep(sweep_param, sweep_values, sweep_transitions, seed + ".sweep.out",
+                 config.getIntValue("xr_print_precision"));
+    }
+    if (abundances.size() > 0) {
+      writeIsotopeMixture(isotopes, isotope_transitions, weights, seed + ".mix.out",
+                          config.getIntValue("xr_print_precision"));
+    }
   }
 
   if (output_verbosity >= 2) {
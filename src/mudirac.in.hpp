@@ -36,4 +36,12 @@ struct TransLineSpec {
   int n1, n2;
   int l1, l2;
   bool s1, s2;
-};
\ No newline at end of file
+};
+
+vector<TransitionData> computeTransitions(DiracAtom &da, vector<TransLineSpec> transqnums);
+vector<vector<TransitionData>> computeIsotopeTransitions(MuDiracInputFile &config, DiracAtom &da_ref, vector<int> isotopes,
+                                                         vector<TransLineSpec> transqnums);
+
+void setSweepParameter(DiracAtom &da, string param, double value, double fc);
+vector<vector<TransitionData>> computeSweepTransitions(MuDiracInputFile &config, DiracAtom &da_ref, string param,
+                                                       vector<double> values, vector<TransLineSpec> transqnums);
@@ -0,0 +1 @@
+#define CURRENT_DATAPATH "/root/repo/_gate_build/test"
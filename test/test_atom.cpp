@@ -2,6 +2,7 @@
 #include "../lib/hydrogenic.hpp"
 #include "../lib/utils.hpp"
 #include "../vendor/aixlog/aixlog.hpp"
+#include "datapath.h"
 #include <cmath>
 #include <iostream>
 #include <limits>
@@ -63,6 +64,36 @@ TEST_CASE("Dirac Atom - grid", "[DiracAtom]")
   // Must throw runtime_error for invalid out_eps
   da.out_eps = 2;
   REQUIRE_THROWS(da.gridLimits(E0, k));
+
+  // Tabulated potential must match the direct one, also when extended
+  // or after the potential changes
+  DiracAtom da2 = DiracAtom(26, Physical::m_mu, 56, SPHERE);
+  vector<double> Vt = da2.getVgrid(-10, 10);
+  for (int i = -10; i <= 10; ++i) {
+    REQUIRE(Vt[i + 10] == da2.getV(da2.getrc() * exp(i * da2.getdx())));
+  }
+  Vt = da2.getVgrid(-20, 20);
+  REQUIRE(Vt.size() == 41);
+  REQUIRE(Vt[0] == da2.getV(da2.getrc() * exp(-20 * da2.getdx())));
+  REQUIRE(Vt[40] == da2.getV(da2.getrc() * exp(20 * da2.getdx())));
+  da2.setUehling(true, 100);
+  Vt = da2.getVgrid(0, 0);
+  REQUIRE(Vt[0] == da2.getV(da2.getrc()));
+  REQUIRE_THROWS(da2.getVgrid(1, 0));
+
+  // States share the grid and potential of the atom, and keep theirs if
+  // the tables are replaced
+  DiracState ds1 = da2.initState(hydrogenicDiracEnergy(26, da2.getmu(), 2, -1), -1);
+  DiracState ds2 = ds1;
+  REQUIRE(ds2.grid.begin() == ds1.grid.begin());
+  REQUIRE(ds2.V.begin() == ds1.V.begin());
+  REQUIRE(ds2.P.data() != ds1.P.data());
+  ds1.resize(ds1.grid_indices.first + 1, ds1.grid_indices.second);
+  REQUIRE(ds1.grid.begin() == ds2.grid.begin() + 1);
+  da2.setUehling(false);
+  DiracState ds3 = da2.initState(ds2.E, -1);
+  REQUIRE(ds3.V[0] != ds2.V[0]);
+  REQUIRE(ds2.V[0] == Approx(ds3.V[0]).epsilon(1e-2));
 }
 
 TEST_CASE("Dirac Atom - energy search", "[DiracAtom]")
@@ -103,6 +134,338 @@ TEST_CASE("Dirac Atom - energy search", "[DiracAtom]")
   // And test full convergence
   ds = da.convergeState(2, -1);
   REQUIRE(ds.E == Approx(Es2));
+
+  // Both energy search methods must agree
+  da.Esearch = DAMPED_NEWTON;
+  DiracState dsd = da.convergeState(2, -1);
+  da.Esearch = SAFE_NEWTON;
+  REQUIRE(dsd.E == Approx(ds.E));
+  REQUIRE(dsd.nodes == ds.nodes);
+}
+
+TEST_CASE("Dirac Atom - Pruefer phase", "[DiracAtom]")
+{
+  DiracAtom da = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+
+  for (int n = 1; n <= 3; ++n) {
+    for (int l = 0; l < n; ++l) {
+      for (int s = 0; s < 2; ++s) {
+        if (l == 0 && !s)
+          continue;
+        DiracState ds = da.getState(n, l, s);
+        // At the eigenvalue the phase counts n-|k|, and grows with E
+        double ph = da.phaseCount(ds.E, ds.k);
+        REQUIRE(ph == Approx(n - abs(ds.k)).margin(1e-3));
+        REQUIRE(da.phaseCount(ds.E * (1 - 1e-6), ds.k) < ph);
+        REQUIRE(da.phaseCount(ds.E * (1 + 1e-6), ds.k) > ph);
+      }
+    }
+  }
+
+  // Node search with and without the phase must give the same states
+  DiracAtom da_nodes = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  da_nodes.pruefer_nodes = false;
+  REQUIRE(da_nodes.getState(3, 1, false).E ==
+          Approx(da.getState(3, 1, false).E).epsilon(1e-10));
+}
+
+TEST_CASE("Dirac Atom - kappa series", "[DiracAtom]")
+{
+  // A whole series must match the states solved one by one
+  DiracAtom da_series = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  DiracAtom da_single = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+
+  da_series.calcKappaSeries(1, 4);
+  da_series.calcKappaSeries(-1, 2);
+  da_series.maxit_state = 0; // Would fail if anything was missing
+  for (int n = 2; n <= 4; ++n) {
+    REQUIRE(da_series.getState(n, 1, false).E ==
+            Approx(da_single.getState(n, 1, false).E).epsilon(1e-10));
+  }
+
+  // For l = 0 both spins are the same state
+  REQUIRE(da_series.getState(2, 0, false).E == da_series.getState(2, 0, true).E);
+}
+
+TEST_CASE("Dirac Atom - B-spline solver", "[DiracAtom]")
+{
+  // Point nucleus, compared with the exact solution
+  DiracAtom da_point = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::POINT);
+  da_point.solver = BSPLINE;
+  da_point.calcKappaSeries(-1, 3);
+  da_point.calcKappaSeries(-2, 3);
+  da_point.maxit_state = 0; // Would fail if anything was missing
+  for (int n = 1; n <= 3; ++n) {
+    DiracState ds = da_point.getState(n, 0, false);
+    REQUIRE(ds.E == Approx(hydrogenicDiracEnergy(26, da_point.getmu(), n, -1)).epsilon(1e-10));
+    REQUIRE(ds.nodes == n - 1);
+  }
+  REQUIRE(da_point.getState(3, 1, true).E ==
+          Approx(hydrogenicDiracEnergy(26, da_point.getmu(), 3, -2)).epsilon(1e-10));
+
+  // Finite nucleus, compared with shooting
+  DiracAtom da_bspl = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  DiracAtom da_shoot = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  da_bspl.solver = BSPLINE;
+  for (int n = 2; n <= 3; ++n) {
+    DiracState ds_bspl = da_bspl.getState(n, 1, false);
+    DiracState ds_shoot = da_shoot.getState(n, 1, false);
+    REQUIRE((ds_bspl.E - ds_shoot.E) / (ds_shoot.E - da_shoot.getRestE()) ==
+            Approx(0).margin(1e-5));
+    REQUIRE(ds_bspl.nodes == ds_shoot.nodes);
+  }
+}
+
+TEST_CASE("Dirac Atom - integration methods", "[DiracAtom]")
+{
+  // Point nucleus, compared with the exact solution on a coarse grid
+  double E_exact = hydrogenicDiracEnergy(26, DiracAtom(26, Physical::m_mu, 56).getmu(), 2, 1);
+  DiracAtom da_rk4 = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::POINT, 1.0, 0.04);
+  DiracAtom da_am6 = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::POINT, 1.0, 0.04);
+  da_am6.shoot_method = ADAMS_MOULTON6;
+  double err_rk4 = abs(da_rk4.getState(2, 1, false).E - E_exact) / Physical::eV;
+  double err_am6 = abs(da_am6.getState(2, 1, false).E - E_exact) / Physical::eV;
+  REQUIRE(err_am6 < 5e-3);
+  REQUIRE(err_am6 < err_rk4 / 10);
+
+  // Finite nucleus: the higher order methods agree on grids of different
+  // steps
+  DiracAtom da_mid = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  DiracAtom da_am6s = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.02);
+  da_mid.shoot_method = RK4_MIDPOINT;
+  da_am6s.shoot_method = ADAMS_MOULTON6;
+  DiracState ds_mid = da_mid.getState(1, 0, false);
+  DiracState ds_am6 = da_am6s.getState(1, 0, false);
+  REQUIRE((ds_am6.E - ds_mid.E) / (ds_mid.E - da_mid.getRestE()) == Approx(0).margin(1e-8));
+  REQUIRE(ds_am6.nodes == 0);
+}
+
+TEST_CASE("Dirac Atom - Richardson extrapolation", "[DiracAtom]")
+{
+  // Reference from a more accurate method
+  DiracAtom da_ref = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  da_ref.shoot_method = ADAMS_MOULTON6;
+  DiracState ds_ref = da_ref.getState(1, 0, false);
+  double Eb = ds_ref.E - da_ref.getRestE();
+
+  DiracAtom da = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  DiracState ds0 = da.getState(1, 0, false);
+  REQUIRE(ds0.E_err == 0);
+  da.richardson_levels = 2;
+  da.reset();
+  DiracState ds2 = da.getState(1, 0, false);
+  da.richardson_levels = 3;
+  da.reset();
+  DiracState ds3 = da.getState(1, 0, false);
+
+  REQUIRE(abs((ds2.E - ds_ref.E) / Eb) < 1e-3 * abs((ds0.E - ds_ref.E) / Eb));
+  REQUIRE(abs(ds2.E - ds_ref.E) < ds2.E_err);
+  REQUIRE(abs(ds3.E - ds_ref.E) < abs(ds2.E - ds_ref.E));
+  REQUIRE(ds3.E_err < ds2.E_err);
+  // The wavefunction stays on the original grid
+  REQUIRE(ds3.grid_indices == ds0.grid_indices);
+}
+
+TEST_CASE("Dirac Atom - target accuracy", "[DiracAtom]")
+{
+  double acc = 0.1 * Physical::eV;
+  // Reference from a more accurate method
+  DiracAtom da_ref = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.0025);
+  da_ref.shoot_method = ADAMS_MOULTON6;
+
+  DiracAtom da = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  da.setTargetAccuracy(acc);
+  REQUIRE(da.Etol == Approx(acc / 20));
+
+  for (int l = 0; l < 2; ++l) {
+    DiracState ds_ref = da_ref.getState(2, l, false);
+    DiracState ds = da.getState(2, l, false);
+    REQUIRE(ds.E_err > 0);
+    REQUIRE(ds.E_err < acc / 2);
+    REQUIRE(abs(ds.E - ds_ref.E) < acc / 2);
+  }
+}
+
+TEST_CASE("Dirac Atom - multigrid search", "[DiracAtom]")
+{
+  DiracAtom da = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  DiracAtom da_mg = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  da_mg.multigrid_factor = 4;
+
+  for (int n = 1; n <= 3; ++n) {
+    for (int l = 0; l < n; ++l) {
+      DiracState ds = da.getState(n, l, false);
+      DiracState ds_mg = da_mg.getState(n, l, false);
+      REQUIRE(ds_mg.nodes == ds.nodes);
+      REQUIRE(ds_mg.E == Approx(ds.E).epsilon(0).margin(10 * da.Etol));
+      REQUIRE(ds_mg.grid_indices == ds.grid_indices);
+    }
+  }
+}
+
+TEST_CASE("Dirac Atom - series boundaries", "[DiracAtom]")
+{
+  // Point nucleus, compared with the exact solution
+  DiracAtom da = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::POINT, 1.0, 0.005);
+  DiracAtom da_sb = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::POINT, 1.0, 0.005);
+  da.shoot_method = ADAMS_MOULTON6;
+  da_sb.shoot_method = ADAMS_MOULTON6;
+  da_sb.series_boundaries = true;
+
+  for (int n = 1; n <= 3; ++n) {
+    for (int l = 0; l < n; ++l) {
+      int k;
+      qnumSchro2Dirac(l, false, k);
+      double E_exact = hydrogenicDiracEnergy(82, da.getmu(), n, k);
+      DiracState ds = da.getState(n, l, false);
+      DiracState ds_sb = da_sb.getState(n, l, false);
+      REQUIRE(ds_sb.nodes == ds.nodes);
+      REQUIRE(abs(ds_sb.E - E_exact) / Physical::eV < 1e-3);
+      REQUIRE(abs(ds_sb.E - E_exact) < abs(ds.E - E_exact));
+    }
+  }
+
+  // Finite nucleus: same energies as without
+  DiracAtom da_f = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  DiracAtom da_fsb = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  da_f.shoot_method = ADAMS_MOULTON6;
+  da_fsb.shoot_method = ADAMS_MOULTON6;
+  da_fsb.series_boundaries = true;
+  for (int l = 0; l < 2; ++l) {
+    DiracState ds = da_f.getState(2, l, false);
+    DiracState ds_sb = da_fsb.getState(2, l, false);
+    REQUIRE(ds_sb.nodes == ds.nodes);
+    REQUIRE(abs(ds_sb.E - ds.E) / Physical::eV < 0.02);
+    REQUIRE(ds_sb.grid_indices == ds.grid_indices);
+  }
+}
+
+TEST_CASE("Dirac Atom - perturbative corrections", "[DiracAtom]")
+{
+  DiracAtom da_0 = DiracAtom(20, Physical::m_mu, 40, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  DiracAtom da_f = DiracAtom(20, Physical::m_mu, 40, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  DiracAtom da_p = DiracAtom(20, Physical::m_mu, 40, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  da_f.setUehling(true, 100);
+  da_p.setCorrectionMode(PERTURBATIVE_CORRECTIONS);
+  da_p.setUehling(true, 100);
+
+  for (int n = 1; n <= 2; ++n) {
+    for (int l = 0; l < n; ++l) {
+      DiracState ds_0 = da_0.getState(n, l, false);
+      DiracState ds_f = da_f.getState(n, l, false);
+      DiracState ds_p = da_p.getState(n, l, false);
+      REQUIRE(ds_p.nodes == ds_f.nodes);
+      // The wavefunction is the one of the nuclear potential alone
+      REQUIRE(ds_p.P == ds_0.P);
+      // The estimate of the second order bounds the difference, which is a
+      // small fraction of the correction
+      REQUIRE(ds_p.E_err > 0);
+      REQUIRE(abs(ds_p.E - ds_f.E) < ds_p.E_err);
+      REQUIRE(abs(ds_p.E - ds_f.E) < 0.05 * abs(ds_f.E - ds_0.E));
+    }
+  }
+
+  // Switching the correction off does not recompute the states
+  da_p.setUehling(false);
+  DiracState ds_0 = da_0.getState(1, 0, false);
+  DiracState ds_p = da_p.getState(1, 0, false);
+  REQUIRE(ds_p.E == ds_0.E);
+  REQUIRE(ds_p.E_err == 0);
+}
+
+TEST_CASE("Dirac Atom - warm starts", "[DiracAtom]")
+{
+  DiracAtom da = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  DiracAtom da_u = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  da_u.setUehling(true, 100);
+  da_u.setFermi2(1.1 * Physical::fermi2_T);
+
+  da.calcAllStates(3);
+  // Each change starts from the states found before it
+  da.setUehling(true, 100);
+  da.calcAllStates(3);
+  da.setFermi2(1.1 * Physical::fermi2_T);
+
+  for (int n = 1; n <= 3; ++n) {
+    for (int l = 0; l < n; ++l) {
+      DiracState ds = da.getState(n, l, false);
+      DiracState ds_u = da_u.getState(n, l, false);
+      REQUIRE(ds.nodes == ds_u.nodes);
+      REQUIRE(ds.E == Approx(ds_u.E).epsilon(0).margin(10 * da.Etol));
+      REQUIRE(ds.grid_indices == ds_u.grid_indices);
+    }
+  }
+
+  // And a change of grid from those found on the previous one
+  da.setgrid(da.getrc(), 0.004);
+  da_u.setgrid(da_u.getrc(), 0.004);
+  DiracState ds = da.getState(2, 1, false);
+  DiracState ds_u = da_u.getState(2, 1, false);
+  REQUIRE(ds.E == Approx(ds_u.E).epsilon(0).margin(10 * da.Etol));
+
+  // Or from another isotope
+  DiracAtom da_204 = DiracAtom(82, Physical::m_mu, 204, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  DiracAtom da_204w = DiracAtom(82, Physical::m_mu, 204, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  da.setgrid(da.getrc(), 0.005);
+  da.calcAllStates(2);
+  da_204w.warmStart(da);
+  for (int l = 0; l < 2; ++l) {
+    DiracState ds_204 = da_204.getState(2, l, false);
+    DiracState ds_204w = da_204w.getState(2, l, false);
+    REQUIRE(ds_204w.nodes == ds_204.nodes);
+    REQUIRE(ds_204w.E == Approx(ds_204.E).epsilon(0).margin(10 * da.Etol));
+  }
+
+  // Or from a different nuclear radius
+  DiracAtom da_s = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  DiracAtom da_sr = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::SPHERE, 1.0, 0.005);
+  da_s.calcAllStates(2);
+  double E1s = da_s.getState(1, 0, false).E;
+  da_s.setRadius(1.05 * da_s.getR());
+  da_sr.setRadius(1.05 * da_sr.getR());
+  REQUIRE(da_s.getR() == da_sr.getR());
+  for (int l = 0; l < 2; ++l) {
+    DiracState ds_s = da_s.getState(2, l, false);
+    DiracState ds_sr = da_sr.getState(2, l, false);
+    REQUIRE(ds_s.nodes == ds_sr.nodes);
+    REQUIRE(ds_s.E == Approx(ds_sr.E).epsilon(0).margin(10 * da.Etol));
+  }
+  // A larger nucleus binds less
+  REQUIRE(da_s.getState(1, 0, false).E > E1s);
+}
+
+TEST_CASE("Dirac Atom - parameter sweep", "[DiracAtom]")
+{
+  // Each point of a sweep, warm started from the previous one, must match a
+  // new atom set up at that point
+  DiracAtom da_ref = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  da_ref.calcAllStates(2);
+
+  DiracAtom da = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+  da.warmStart(da_ref);
+
+  for (int p = 1; p <= 2; ++p) {
+    double R = (1 + 0.02 * p) * da_ref.getR();
+    double rc = max(1.0 / (da.getZ() * da.getmu()), R);
+    double T = (1 + 0.05 * p) * Physical::fermi2_T;
+    da.setRadius(R, rc);
+    da.setFermi2(T);
+
+    DiracAtom da_new = DiracAtom(82, Physical::m_mu, 208, NuclearRadiusModel::FERMI2, 1.0, 0.005);
+    da_new.setRadius(R, rc);
+    da_new.setFermi2(T);
+    REQUIRE(da.getrc() == da_new.getrc());
+
+    for (int n = 1; n <= 2; ++n) {
+      for (int l = 0; l < n; ++l) {
+        DiracState ds = da.getState(n, l, false);
+        DiracState ds_new = da_new.getState(n, l, false);
+        REQUIRE(ds.nodes == ds_new.nodes);
+        REQUIRE(ds.E == Approx(ds_new.E).epsilon(0).margin(10 * da.Etol));
+        REQUIRE(ds.grid_indices == ds_new.grid_indices);
+      }
+    }
+  }
 }
 
 TEST_CASE("Dirac Atom - transitions", "[DiracAtom]")
@@ -136,4 +499,60 @@ TEST_CASE("Dirac Atom - transitions", "[DiracAtom]")
       tmat.totalRate() * Physical::s ==
       Approx(1.31e7).epsilon(
           3e-2)); // Precision is not strong here... possibly needs improvement
-}
\ No newline at end of file
+}
+
+TEST_CASE("Dirac Atom - parallel states", "[DiracAtom]")
+{
+  // States computed in parallel must match the ones computed serially
+  DiracAtom da_serial = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  DiracAtom da_parallel = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  vector<tuple<int, int, bool>> qnums;
+
+  for (int n = 1; n <= 3; ++n) {
+    for (int l = 0; l < n; ++l) {
+      qnums.push_back(make_tuple(n, l, true));
+    }
+  }
+
+  da_parallel.nthreads = 3;
+  da_parallel.calcStates(qnums);
+
+  for (int i = 0; i < (int)qnums.size(); ++i) {
+    int n = get<0>(qnums[i]), l = get<1>(qnums[i]);
+    REQUIRE(da_parallel.getState(n, l, true).E ==
+            Approx(da_serial.getState(n, l, true).E).epsilon(1e-12));
+  }
+}
+
+TEST_CASE("Dirac Atom - state cache", "[DiracAtom]")
+{
+  DiracAtom da = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  da.setStateCache(CURRENT_DATAPATH);
+  // Remove the cache file whether or not the test passes
+  struct CacheCleanup {
+    string fname;
+    ~CacheCleanup() {
+      remove(fname.c_str());
+    };
+  } cleanup{da.stateCacheFile()};
+  remove(cleanup.fname.c_str());
+
+  DiracState ds1 = da.getState(2, 1, true);
+  da.saveStateCache();
+
+  // Same settings: the state must come from the cache
+  DiracAtom da_cached = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  da_cached.setStateCache(CURRENT_DATAPATH);
+  REQUIRE(da_cached.stateCacheFile() == da.stateCacheFile());
+  da_cached.maxit_state = 0; // Would fail if it tried to converge anything
+  DiracState ds2 = da_cached.getState(2, 1, true);
+  REQUIRE(ds2.E == ds1.E);
+  REQUIRE(ds2.P == ds1.P);
+  REQUIRE(ds2.grid_indices == ds1.grid_indices);
+
+  // Different settings must not share the file
+  DiracAtom da_other = DiracAtom(26, Physical::m_mu, 56, NuclearRadiusModel::SPHERE);
+  da_other.setStateCache(CURRENT_DATAPATH);
+  da_other.Etol = 1e-8;
+  REQUIRE(da_other.stateCacheFile() != da.stateCacheFile());
+}
@@ -168,10 +168,11 @@ double shootPotentialTest(double (*fV)(double), double (*frho)(double),
 }
 
 double diracTest(double Z, double mu, int n, int k,
-                 double x0 = 1e-3, double x1 = 1e1, int N = 200)
+                 double x0 = 1e-3, double x1 = 1e1, int N = 200,
+                 DiracIntegrator method = RK4_AVERAGED)
 {
     double err = 0.0;
-    vector<double> Q(N), P(N), V(N);
+    vector<double> Q(N), P(N), V(N), Vmid(N - 1);
     vector<vector<double>> grid = logGrid(x0, x1, N);
     double E = hydrogenicDiracEnergy(Z, mu, n, k);
     vector<vector<double>> PQ = hydrogenicDiracWavefunction(grid[1], Z, mu, n, k);
@@ -180,6 +181,11 @@ double diracTest(double Z, double mu, int n, int k,
     {
         V[i] = -Z / grid[1][i];
     }
+    for (int i = 0; i < N - 1; ++i)
+    {
+        Vmid[i] = -Z / sqrt(grid[1][i] * grid[1][i + 1]);
+    }
+    auto Vfunc = [Z](double r) { return -Z / r; };
 
     // Apply just the known solution as boundary conditions
     for (int i = 0; i < 2; ++i)
@@ -189,7 +195,8 @@ double diracTest(double Z, double mu, int n, int k,
         P[N - i - 1] = PQ[0][N - i - 1];
         Q[N - i - 1] = PQ[1][N - i - 1];
     }
-    TurningPoint tp = shootDiracLog(Q, P, grid[1], V, E, k, mu, grid[0][1] - grid[0][0]);
+    TurningPoint tp = shootDiracLog(Q, P, grid[1], V, E, k, mu, grid[0][1] - grid[0][0], false, 1, Vmid,
+                                    method, Vfunc);
 
     // Now on to rescale in order to make the two functions comparable
     double norm_i = tp.Pi / PQ[0][tp.i];
@@ -282,4 +289,185 @@ TEST_CASE("Dirac integration", "[shootDiracLog]")
     REQUIRE(diracTest(1, 1, 2, 1, 2e-4, 2e2, 1000) < ERRTOL_LOW);
     REQUIRE(diracTest(1, 1, 3, 1, 2e-4, 2e2, 1000) < ERRTOL_LOW);
     REQUIRE(diracTest(5, 1, 1, -1, 1e-4, 1e2, 1000) < ERRTOL_LOW);
-}
\ No newline at end of file
+
+    // The higher order and adaptive methods reach the 'high' tolerance on a
+    // much coarser grid
+    REQUIRE(diracTest(1, 1, 2, 1, 2e-4, 2e2, 250, ADAMS_MOULTON6) < ERRTOL_HIGH);
+    REQUIRE(diracTest(5, 1, 1, -1, 1e-4, 1e2, 250, ADAMS_MOULTON6) < ERRTOL_HIGH);
+    REQUIRE(diracTest(1, 1, 2, 1, 2e-4, 2e2, 100, DORMAND_PRINCE) < ERRTOL_HIGH);
+    REQUIRE(diracTest(5, 1, 1, -1, 1e-4, 1e2, 100, DORMAND_PRINCE) < ERRTOL_HIGH);
+
+    // Integrating forward and backwards on two threads must give exactly
+    // the same result
+    int N = 1000;
+    vector<vector<double>> grid = logGrid(1e-4, 1e2, N);
+    vector<double> V(N), Qs(N, 0), Ps(N, 0);
+    for (int i = 0; i < N; ++i)
+    {
+        V[i] = -1.0 / grid[1][i];
+    }
+    Ps[0] = grid[1][0];
+    Ps[N - 1] = 1e-30;
+    vector<double> Qp = Qs, Pp = Ps;
+    double E = hydrogenicDiracEnergy(1, 1, 2, -1);
+    TurningPoint tps = shootDiracLog(Qs, Ps, grid[1], V, E, -1, 1, grid[0][1] - grid[0][0]);
+    TurningPoint tpp = shootDiracLog(Qp, Pp, grid[1], V, E, -1, 1, grid[0][1] - grid[0][0], true);
+    REQUIRE(tps.i == tpp.i);
+    REQUIRE(tps.Qi == tpp.Qi);
+    REQUIRE(tps.Pe == tpp.Pe);
+    REQUIRE(Qs == Qp);
+    REQUIRE(Ps == Pp);
+
+    // Multiple shooting must agree up to rounding errors
+    vector<double> Qm(N, 0), Pm(N, 0);
+    Pm[0] = Ps[0] = grid[1][0];
+    Pm[N - 1] = Ps[N - 1] = 1e-30;
+    Qs[1] = Ps[1] = Qs[N - 2] = Ps[N - 2] = 0;
+    tps = shootDiracLog(Qs, Ps, grid[1], V, E, -1, 1, grid[0][1] - grid[0][0]);
+    TurningPoint tpm = shootDiracLog(Qm, Pm, grid[1], V, E, -1, 1, grid[0][1] - grid[0][0], false, 4);
+    REQUIRE(tpm.i == tps.i);
+    REQUIRE(tpm.Qi == Approx(tps.Qi).epsilon(1e-12));
+    REQUIRE(tpm.Pe == Approx(tps.Pe).epsilon(1e-12));
+    for (int i = 0; i < N; ++i)
+    {
+        REQUIRE(Pm[i] == Approx(Ps[i]).epsilon(1e-12));
+    }
+}
+
+TEST_CASE("Dirac integration with energy derivative", "[shootDiracLog]")
+{
+    // Integrating zeta = d/dE (Q/P) along with Q and P must give exactly the
+    // same values at the turning point as integrating it afterwards
+    int N = 1000, k = -1;
+    double E = hydrogenicDiracEnergy(1, 1, 2, k) * (1 + 1e-7);
+    vector<vector<double>> grid = logGrid(1e-4, 1e2, N);
+    double dx = grid[0][1] - grid[0][0];
+    vector<double> V(N), Vmid(N - 1);
+    for (int i = 0; i < N; ++i)
+    {
+        V[i] = -1.0 / grid[1][i];
+    }
+    for (int i = 0; i < N - 1; ++i)
+    {
+        Vmid[i] = -1.0 / sqrt(grid[1][i] * grid[1][i + 1]);
+    }
+
+    for (DiracIntegrator method : {RK4_AVERAGED, ADAMS_MOULTON6})
+    {
+        for (bool parallel : {false, true})
+        {
+            vector<double> Q(N, 0), P(N, 0), zetai(N, 0), zetae(N, 0), y(N);
+            P[0] = grid[1][0];
+            P[N - 1] = 1e-30;
+            TurningPoint tp = shootDiracLog(Q, P, grid[1], V, E, k, 1, dx, parallel, 1, Vmid, method,
+                                            nullptr, 1e-11, boundaryDiracErrorDECoulomb(E, k, 1));
+
+            for (int i = 0; i < N; ++i)
+            {
+                y[i] = Q[i] / P[i];
+            }
+            boundaryDiracErrorDECoulomb(zetae, E, k, 1);
+            shootDiracErrorDELog(zetai, y, grid[1], V, tp.i, E, k, 1, dx, 'f', tp.Qi / tp.Pi);
+            shootDiracErrorDELog(zetae, y, grid[1], V, tp.i, E, k, 1, dx, 'b', tp.Qe / tp.Pe);
+            REQUIRE(tp.zetai == zetai[tp.i]);
+            REQUIRE(tp.zetae == zetae[tp.i]);
+        }
+    }
+}
+
+TEST_CASE("Batched Dirac integration", "[shootDiracLogBatch]")
+{
+    // Several energies at once, each on its own range of a shared grid,
+    // must give exactly the same results as separate integrations
+    int N = 1000, k = -1;
+    double Z = 1, m = 1;
+    vector<vector<double>> grid = logGrid(1e-4, 1e2, N);
+    double dx = grid[0][1] - grid[0][0];
+    vector<double> V(N);
+    for (int i = 0; i < N; ++i)
+    {
+        V[i] = -Z / grid[1][i];
+    }
+
+    double E0 = hydrogenicDiracEnergy(Z, m, 1, k);
+    vector<double> E = {E0 * (1 + 1e-6), E0, E0 * (1 - 1e-6)};
+    vector<pair<int, int>> lims = {{0, N - 1}, {10, N - 30}, {25, N - 1}};
+    vector<vector<double>> Q(3), P(3);
+
+    for (int l = 0; l < 3; ++l)
+    {
+        int n = lims[l].second - lims[l].first + 1;
+        Q[l] = vector<double>(n, 0);
+        P[l] = vector<double>(n, 0);
+        for (int i : {0, 1, n - 2, n - 1})
+        {
+            Q[l][i] = 1e-3 * (i + lims[l].first + 1);
+            P[l][i] = 1.0 / (i + lims[l].first + 1);
+        }
+    }
+    vector<vector<double>> Q0 = Q, P0 = P;
+
+    DiracWorkspace ws;
+    vector<TurningPoint> tps = shootDiracLogBatch(Q, P, grid[1], V, E, lims, k, m, dx, &ws);
+
+    for (int l = 0; l < 3; ++l)
+    {
+        int i0 = lims[l].first, i1 = lims[l].second + 1;
+        vector<double> rl(grid[1].begin() + i0, grid[1].begin() + i1);
+        vector<double> Vl(V.begin() + i0, V.begin() + i1);
+        vector<double> Qs = Q0[l], Ps = P0[l];
+        TurningPoint tp = shootDiracLog(Qs, Ps, rl, Vl, E[l], k, m, dx);
+
+        REQUIRE(tps[l].i == tp.i);
+        REQUIRE(tps[l].Qi == tp.Qi);
+        REQUIRE(tps[l].Pe == tp.Pe);
+        REQUIRE(Q[l] == Qs);
+        REQUIRE(P[l] == Ps);
+    }
+
+    // Reusing the workspace for fewer lanes gives the same results
+    vector<vector<double>> Q1 = {Q0[1]}, P1 = {P0[1]};
+    tps = shootDiracLogBatch(Q1, P1, grid[1], V, vector<double> {E[1]}, {lims[1]}, k, m, dx, &ws);
+    REQUIRE(Q1[0] == Q[1]);
+    REQUIRE(P1[0] == P[1]);
+}
+
+TEST_CASE("Series boundary conditions", "[boundaryDiracSeries]")
+{
+    // Near the origin the series reproduce the known solution, far from it
+    // the asymptotic conditions improve on the leading order ones
+    double Z = 50, m = 1;
+    int N = 1000;
+    for (int k : {-1, 1, -2})
+    {
+        int n = 2 + (k == -2);
+        double E = hydrogenicDiracEnergy(Z, m, n, k);
+        DiracState ds(1e-4 / Z, 100.0 / Z, N), dsc(1e-4 / Z, 100.0 / Z, N);
+        vector<double> V(N);
+        for (int i = 0; i < N; ++i)
+        {
+            V[i] = -Z / ds.grid[i];
+        }
+        ds.V = dsc.V = V;
+        ds.k = dsc.k = k;
+        ds.E = dsc.E = E;
+
+        int i1 = 0;
+        while (ds.grid[i1 + 1] < 0.5 / Z)
+            i1++;
+        boundaryDiracSeries(ds, i1, m, Z, -1);
+        for (int i : {0, i1 / 2, i1})
+        {
+            vector<double> PQ = hydrogenicDiracWavefunction(ds.grid[i], Z, m, n, k);
+            REQUIRE(ds.Q[i] / ds.P[i] == Approx(PQ[1] / PQ[0]).epsilon(1e-10));
+        }
+
+        boundaryDiracAsymptotic(ds);
+        boundaryDiracCoulomb(dsc, m, Z);
+        vector<double> PQ = hydrogenicDiracWavefunction(ds.grid[N - 1], Z, m, n, k);
+        double err = abs(ds.Q[N - 1] / ds.P[N - 1] / (PQ[1] / PQ[0]) - 1);
+        double errc = abs(dsc.Q[N - 1] / dsc.P[N - 1] / (PQ[1] / PQ[0]) - 1);
+        REQUIRE(err < 1e-2);
+        REQUIRE(err < errc / 10);
+    }
+}
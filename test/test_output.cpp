@@ -0,0 +1,127 @@
+#include "../lib/atom.hpp"
+#include "../lib/constants.hpp"
+#include "../lib/output.hpp"
+#include "datapath.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../vendor/catch/catch.hpp"
+
+using namespace std;
+
+// Removes a file when going out of scope, whether or not the test passed
+struct TempFile {
+  string fname;
+  TempFile(string name) : fname(string(CURRENT_DATAPATH) + "/" + name) {};
+  ~TempFile() {
+    remove(fname.c_str());
+  };
+};
+
+string readFile(string fname)
+{
+  ifstream in(fname);
+  stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// A line of energy dE (eV) and total rate W (s^-1)
+TransitionData makeTransition(string name, double dE, double W)
+{
+  TransitionData t;
+  t.name = name;
+  t.ds1.E = -1e6 * Physical::eV;
+  t.ds2.E = t.ds1.E + dE * Physical::eV;
+  t.tmat = TransitionMatrix(-1, 2);
+  for (int i = 0; i < (int)t.tmat.m1.size(); ++i) {
+    t.tmat.T[i][0] = W / Physical::s;
+  }
+  return t;
+}
+
+TEST_CASE("Simulated spectrum", "[writeSimSpec]")
+{
+  vector<TransitionData> t1 = {makeTransition("K1-L2", 5000, 1e15), makeTransition("K1-L3", 5200, 2e15)};
+  vector<TransitionData> t2 = {makeTransition("K1-L2", 5050, 1e15)};
+  double dE = 10, lw = 50, expd = 1e4;
+
+  // A single isotope gives the spectrum as it always did
+  TempFile spec("test_output_spec.dat");
+  writeSimSpec(t1, dE, lw, expd, spec.fname);
+
+  ostringstream ref;
+  double minE = max(0.0, 5000 - 5 * lw), maxE = 5200 + 5 * lw;
+  for (double E = minE; E <= maxE; E += dE) {
+    ref << E << '\t';
+    double S = 0.0;
+    for (int i = 0; i < (int)t1.size(); ++i) {
+      double Ei = (t1[i].ds2.E - t1[i].ds1.E) / Physical::eV;
+      S += exp(-0.5 * pow((Ei - E) / lw, 2)) * t1[i].tmat.totalRate() * t1[i].tmat.m1.size();
+    }
+    S *= exp(-E / expd);
+    ref << S << '\n';
+  }
+  REQUIRE(readFile(spec.fname) == ref.str());
+
+  // A mixture weighs each isotope by its abundance
+  TempFile mix("test_output_mix.dat");
+  writeSimSpec(vector<vector<TransitionData>> {t1, t2}, vector<double> {0.25, 0.75}, dE, lw, expd, mix.fname);
+  ifstream in(mix.fname);
+  double E, S;
+  int npoints = 0;
+  while (in >> E >> S) {
+    double S_ref = 0.0;
+    for (int i = 0; i < (int)t1.size(); ++i) {
+      S_ref += 0.25 * exp(-0.5 * pow(((t1[i].ds2.E - t1[i].ds1.E) / Physical::eV - E) / lw, 2)) *
+               t1[i].tmat.totalRate() * t1[i].tmat.m1.size();
+    }
+    S_ref += 0.75 * exp(-0.5 * pow(((t2[0].ds2.E - t2[0].ds1.E) / Physical::eV - E) / lw, 2)) *
+             t2[0].tmat.totalRate() * t2[0].tmat.m1.size();
+    S_ref *= exp(-E / expd);
+    REQUIRE(S == Approx(S_ref).epsilon(1e-5));
+    ++npoints;
+  }
+  REQUIRE(npoints == (int)((maxE - minE) / dE) + 1);
+}
+
+TEST_CASE("Isotope mixture table", "[writeIsotopeMixture]")
+{
+  vector<int> isotopes = {204, 206, 208};
+  vector<vector<TransitionData>> transitions = {
+    {makeTransition("K1-L2", 5100, 1e15)},
+    {makeTransition("K1-L2", 5050, 1e15), makeTransition("K1-L3", -10, 1e15)},
+    {makeTransition("K1-L2", 5000, 1e15), makeTransition("K1-L3", 5200, 2e15)}
+  };
+  vector<double> weights = {0.0, 0.4, 0.6};
+
+  TempFile table("test_output.mix.out");
+  writeIsotopeMixture(isotopes, transitions, weights, table.fname, 3);
+
+  ifstream in(table.fname);
+  string line;
+  getline(in, line);
+  REQUIRE(line == "# Isotope mixture: A = 206 (0.4) A = 208 (0.6)");
+  getline(in, line);
+  REQUIRE(line == "Line\tA\tDeltaE (eV)\tAbundance x W_12 (s^-1)");
+
+  // Isotopes not in the mixture and invisible lines are skipped
+  vector<string> names = {"K1-L2", "K1-L2", "K1-L3"};
+  vector<int> A = {206, 208, 208};
+  vector<double> dE = {5050, 5000, 5200}, W = {0.4e15, 0.6e15, 1.2e15};
+  for (int i = 0; i < 3; ++i) {
+    string name;
+    int Ai;
+    double dEi, Wi;
+    REQUIRE(in >> name >> Ai >> dEi >> Wi);
+    REQUIRE(name == names[i]);
+    REQUIRE(Ai == A[i]);
+    REQUIRE(dEi == Approx(dE[i]).epsilon(1e-6));
+    REQUIRE(Wi == Approx(W[i]).epsilon(1e-6));
+  }
+  REQUIRE(!(in >> line));
+}
@@ -84,6 +84,23 @@ TEST_CASE("Uehling correction to Coulomb potential",
   REQUIRE(cpot.V(rlow) == Approx(Vlow).epsilon(1e-3));
   REQUIRE(cpot.V(rhigh) ==
           Approx(Vhigh).margin(1e-3)); // This being a 0, we use absolute values
+
+  // Tabulated version
+  cpot.set_exp_cutoffs(0, INFINITY);
+  cpot.set_tabulated(true);
+  REQUIRE(cpot.get_tabulated());
+  REQUIRE(cpot.get_table_error() < ERRTOL_HIGH);
+  REQUIRE(cpot.V(0.01) == Approx(cpot.Vintegral(0.01)).epsilon(ERRTOL_HIGH));
+  REQUIRE(cpot.V(5e-5) == Approx(cpot.Vintegral(5e-5)).epsilon(ERRTOL_HIGH));
+  REQUIRE(cpot.V(rlow) == Approx(Vlow).epsilon(1e-3));
+  REQUIRE(cpot.V(rhigh) == Approx(Vhigh).margin(1e-3));
+  cpot.set_tabulated(false);
+  REQUIRE(!cpot.get_tabulated());
+
+  cpot = UehlingSpherePotential(92, -1, 2000);
+  cpot.set_tabulated(true);
+  REQUIRE(cpot.V(0.01) == Approx(-0.1795).epsilon(1e-3));
+  REQUIRE(cpot.V(5e-5) == Approx(-10225.5698).epsilon(1e-3));
 }
 
 TEST_CASE("Background charge on grid potential", "[BkgGridPotential]") {
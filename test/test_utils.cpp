@@ -86,6 +86,19 @@ TEST_CASE("Vector operations", "[vectorOperation]")
     CHECK(vectorOperation(v1, 3.0, '^') == vector<double>{8, 8, 8});
 }
 
+TEST_CASE("Array views", "[ArrayView]")
+{
+    vector<double> v = {1, 2, 3, 4, 5};
+    ArrayView av = v;
+    ArrayView sl = av.slice(1, 4);
+
+    CHECK(av.size() == 5);
+    CHECK(av.data() == v.data());
+    CHECK(sl.size() == 3);
+    CHECK(sl[0] == 2);
+    CHECK(sl.toVector() == vector<double>{2, 3, 4});
+}
+
 TEST_CASE("Logarithmic grids", "[logGrid]")
 {
     // Test center + step form